@@ -34,6 +34,7 @@ implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
 
 CHANGE HISTORY:
 
+17 October 2026 -- LAS_PATH_SEPARATOR and ispathrelative(), builds on Linux too
 3 April 2017 -- created in Benoit St-Onge's Lab at UQAM in Montreal
 
 ===============================================================================
@@ -42,8 +43,15 @@ CHANGE HISTORY:
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#ifdef _WIN32
 #include <windows.h> //for GetFileAttributesA()
+#else
+#include <sys/stat.h> //for stat()
+#include <unistd.h> //for getcwd()
+#include <limits.h> //for PATH_MAX
+#endif
 #include <algorithm>
+#include <iostream> //for term_progress()
 
 
 //static void byebye(bool error = false, bool wait = false)
@@ -66,6 +74,11 @@ double taketime()
 
 bool direxists(const char* dirname)
 {
+#ifndef _WIN32
+	struct stat st;
+	if (stat(dirname, &st) != 0) return false;  //dirname does not exists!
+	return (S_ISDIR(st.st_mode) != 0);
+#else
 	DWORD ftyp = GetFileAttributesA(dirname);
 	if (ftyp == INVALID_FILE_ATTRIBUTES)
 	{
@@ -78,6 +91,7 @@ bool direxists(const char* dirname)
 		return true;   // this is a directory!
 
 	return false;    // this is not a directory!
+#endif
 }
 
 bool isdir(const char* fullpathname)
@@ -88,16 +102,37 @@ bool isdir(const char* fullpathname)
 std::string getcurrentdirectory()
 {
 	std::string dir;
+#ifdef _WIN32
 	char buffer[_MAX_PATH];
 	if (GetCurrentDirectoryA(_MAX_PATH - 1, buffer) == 0)
 	{
 		fprintf(stderr, "ERROR: GetCurrentDirectoryA() returning 0\n");
 		byebye(true, false);
 	}
+#else
+	char buffer[PATH_MAX];
+	if (getcwd(buffer, PATH_MAX) == 0)
+	{
+		fprintf(stderr, "ERROR: getcwd() returning 0\n");
+		byebye(true, false);
+	}
+#endif
 	dir = buffer;
 	return dir;
 }
 
+//return true if path is not absolute, as PathIsRelative() does
+bool ispathrelative(std::string path)
+{
+#ifdef _WIN32
+	//drive letter or UNC path
+	if (path.size() >= 2 && path[1] == ':') return false;
+	return (path.empty() || (path[0] != '\\' && path[0] != '/'));
+#else
+	return (path.empty() || path[0] != '/');
+#endif
+}
+
 //gets path, it is the path without the filename
 std::string getpathonly(std::string path)
 {
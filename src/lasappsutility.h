@@ -34,6 +34,7 @@ implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
 
 CHANGE HISTORY:
 
+17 October 2026 -- LAS_PATH_SEPARATOR and ispathrelative(), builds on Linux too
 3 April 2017 -- created in Benoit St-Onge's Lab at UQAM in Montreal
 
 ===============================================================================
@@ -44,12 +45,22 @@ void byebye(bool error = false, bool wait = false);
 
 double taketime();
 
+//separator of the directories in a path
+#ifdef _WIN32
+#define LAS_PATH_SEPARATOR "\\"
+#else
+#define LAS_PATH_SEPARATOR "/"
+#endif
+
 bool direxists(const char* dirname);
 
 bool isdir(const char* fullpathname);
 
 std::string getcurrentdirectory();
 
+//return true if path is not absolute, as PathIsRelative() does
+bool ispathrelative(std::string path);
+
 //gets path, it is the path without the filename
 std::string getpathonly(std::string path);
 
@@ -9,10 +9,13 @@ This app clips multiple LIDAR data LAS files against multiple
 SHAPEFILE files containing polygons. To each LAS file matches
 a SHAPEFILE file containing a list of polygons. For each polygon,
 this app creates an output LAS file containing the points lying 
-within that polygon.
+within that polygon. With -spatialjoin, the polygons of all the
+SHAPEFILE files are instead joined to the LAS files they overlap,
+and each LAS file is clipped against the polygons joined to it.
 
-This app is multithread and relies on LASapps lasclip to do
-the clipping.
+This app is multithread and relies on the clipping engine of
+LASapps lasclip, run in-process by each of its threads, or on
+lasclip.exe launched once per LAS file when -lasclippath is used.
 
 THANKS:
 
@@ -40,6 +43,16 @@ implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
 
 CHANGE HISTORY:
 
+17 October 2026 -- -manifest outputs matched by name, not by prefix, and unmodified since the job
+17 October 2026 -- in-process engines load points with one thread each, not one per hardware thread
+17 October 2026 -- -spatialjoin tags prefixed by their SHAPEFILE when they overlap
+17 October 2026 -- builds on Linux too, paths joined with LAS_PATH_SEPARATOR
+17 October 2026 -- -manifest appended by batches of jobs instead of rewritten per job
+17 October 2026 -- added -spatialjoin to clip each polygon against all the LAS files it overlaps
+17 October 2026 -- added -manifest to skip the jobs completed by a previous run
+17 October 2026 -- lasclip launched through LASlauncher, added -retries and -jobreport
+17 October 2026 -- jobs pulled largest first by the threads, instead of dealt round-robin
+17 October 2026 -- LAS files clipped in-process by LASclipEngine, -lasclippath optional
 5 April 2017 -- created in Benoit St-Onge's Lab at UQAM in Montreal
 
 ===============================================================================
@@ -53,12 +66,22 @@ CHANGE HISTORY:
 #include <string>
 using namespace std;
 
-#include <windows.h> //for direxists()
-#include <Shlwapi.h> //for PathIsRelative()
 #include "lasappsutility.h"
 #include <iostream> //for term_progress()
 #include <thread>
+#include <atomic>
+#ifdef _WIN32
 #include "dirent.h" //for opendir() and readdir()
+#else
+#include <dirent.h>
+#endif
+#include "lasclipengine.h"
+#include "lastaskscheduler.h"
+#include "laslauncher.h"
+#include "lasjobmanifest.h"
+#include "ogrsf_frmts.h"
+#include <algorithm> //for stable_sort()
+#include <map>
 
 //globals
 string lasfilesfilterstring;
@@ -67,8 +90,32 @@ string outputdirstring;
 string fieldindexnamestring;
 string lasclippathstring;
 string lasclipworkingdirstring;
+string manifeststring;
 
-vector<vector<string>*> global_psyscommandvector_forcore;
+//one job per LAS file, along with its matching SHAPEFILE
+struct LASbatchJob
+{
+	string lasfilename;
+	string shapefilename;
+	string outputdirname;
+	//lasclip program and arguments, when launched
+	vector<string> syscommand;
+	//inputs and options as recorded in the manifest
+	string signature;
+	//polygons of the spatial join, the SHAPEFILEs (in global_shapefilevector)
+	//and for each of them the ids of its features overlapping the LAS file
+	vector<size_t> joinshapefiles;
+	vector< vector<I64> > joinfeatures;
+};
+vector<LASbatchJob> global_jobvector;
+//hands the jobs to the threads as they finish, largest LAS files first
+LAStaskScheduler global_jobscheduler;
+//jobs completed by this and previous runs, when -manifest is used
+LASjobManifest global_jobmanifest;
+std::atomic<int> global_failedjobs(0);
+//SHAPEFILEs of the spatial join
+vector<string> global_shapefilevector;
+bool global_verbose = false;
 
 int matchstringoffset = 0; //defaults to 0
 int matchstringlength = 0; //defaults to 0, no additional substring matching
@@ -77,12 +124,24 @@ int matchstringlength = 0; //defaults to 0, no additional substring matching
 void usage(bool error = false, bool wait = false)
 {
 	fprintf(stderr, "usage:\n");
+	fprintf(stderr, "lasbatchclip -i *.las -poly *.shp -odirbasedonlas -fieldindexname Object_ID -cores 8\n");
 	fprintf(stderr, "lasbatchclip -i *.las -poly *.shp -odirbasedonlas -fieldindexname Object_ID -lasclippath c:\\lasclip.exe -lasclipworkingdir c:\\ -cores 8\n");
+	fprintf(stderr, "lasbatchclip -i *.las -poly *.shp -spatialjoin -odirbasedonlas -fieldindexname Object_ID -cores 8\n");
 	fprintf(stderr, "lasbatchclip -h\n");
 	fprintf(stderr, "----------------------------------------------------------------------------\n");
 	fprintf(stderr, "-i flag to specify LAS input files\n");
 	fprintf(stderr, "-poly flag to specify SHAPEFILE input files\n");
 	fprintf(stderr, "      contain polygons.\n");
+	fprintf(stderr, "-spatialjoin flag is optional, it tells lasbatchclip to clip each\n");
+	fprintf(stderr, "             LAS file against the polygons of all the SHAPEFILE\n");
+	fprintf(stderr, "             files overlapping its bounding box, instead of\n");
+	fprintf(stderr, "             matching LAS and SHAPEFILE filenames. A polygon\n");
+	fprintf(stderr, "             overlapping several LAS files is clipped against\n");
+	fprintf(stderr, "             each of them, into one output LAS file per LAS\n");
+	fprintf(stderr, "             file. When two SHAPEFILEs give the same tag to\n");
+	fprintf(stderr, "             polygons of a LAS file, its outputs are tagged\n");
+	fprintf(stderr, "             with the SHAPEFILE name followed by '_' and the\n");
+	fprintf(stderr, "             tag. Clips in-process only.\n");
 	fprintf(stderr, "-matchstringoffset flag is optional, it specifies the offset\n");
 	fprintf(stderr, "                   in the LAS filename for the matching with\n");
 	fprintf(stderr, "                   the SHAPEFILE filename.\n");
@@ -103,10 +162,26 @@ void usage(bool error = false, bool wait = false)
 	fprintf(stderr, "                polygon index will be used to tag LAS ouput\n");
 	fprintf(stderr, "                files. The field index name should be unique\n");
 	fprintf(stderr, "                for each polygon.\n");
-	fprintf(stderr, "-lasclippath flag is mandatory, it tells lasbatchclip where\n");
-	fprintf(stderr, "             to find lasclip.exe\n");
+	fprintf(stderr, "-lasclippath flag is optional, it tells lasbatchclip where\n");
+	fprintf(stderr, "             to find lasclip.exe, lasclip.exe is then launched\n");
+	fprintf(stderr, "             once per LAS file. Without it, LAS files are\n");
+	fprintf(stderr, "             clipped in-process by the threads of lasbatchclip.\n");
 	fprintf(stderr, "-lasclipworkingdir flag is optional, it tells lasbatchclip which\n");
 	fprintf(stderr, "                   working directory to use for lasclip.exe\n");
+	fprintf(stderr, "-retries flag is optional, it specifies how many more times\n");
+	fprintf(stderr, "         lasclip.exe is launched for a LAS file when it fails,\n");
+	fprintf(stderr, "         the default is 0.\n");
+	fprintf(stderr, "-jobreport flag is optional, it specifies a CSV file where the\n");
+	fprintf(stderr, "           exit code, times and peak memory of each launch of\n");
+	fprintf(stderr, "           lasclip.exe are written.\n");
+	fprintf(stderr, "-manifest flag is optional, it specifies a file where the\n");
+	fprintf(stderr, "          completed jobs are recorded. Run again with the same\n");
+	fprintf(stderr, "          manifest, lasbatchclip skips the LAS files whose LAS\n");
+	fprintf(stderr, "          file, SHAPEFILE and options did not change and whose\n");
+	fprintf(stderr, "          outputs are all still there, unmodified since the\n");
+	fprintf(stderr, "          job completed. The jobs are recorded\n");
+	fprintf(stderr, "          by 64 or every minute, an interrupted run redoes\n");
+	fprintf(stderr, "          those it did not record.\n");
 	fprintf(stderr, "-cores flag is optional, if used it specifies the number of cores to be used.\n");
 	fprintf(stderr, "-verbose flag is optional, if used it details the process.\n");
 	fprintf(stderr, "-h flag is used to produce this usage help screen.\n");
@@ -132,46 +207,314 @@ void usage(bool error = false, bool wait = false)
 	exit(error);
 }
 
-void execute_syscommandvector(int threadid)
+//number of points of a LAS (or LAZ) file, read from its header, 0 if the
+//header cannot be read
+I64 getlasnumberofpoints(const string& lasfilename)
 {
-	//for (int i = 0; i < global_psyscommandvector_forcore[threadid][0].size(); i++)
-	for (int i = 0; i < global_psyscommandvector_forcore[threadid]->size(); i++)
+	unsigned char header[375];
+	FILE* file = fopen(lasfilename.c_str(), "rb");
+	if (file == 0) return 0;
+	size_t size = fread(header, 1, sizeof(header), file);
+	fclose(file);
+	if (size < 227 || memcmp(header, "LASF", 4) != 0) return 0;
+	unsigned int legacynumberofpoints;
+	memcpy(&legacynumberofpoints, &header[107], 4);
+	//LAS 1.4 files may only set the 64 bit number of points
+	if (header[24] == 1 && header[25] >= 4 && size == sizeof(header))
 	{
-		string syscommand = global_psyscommandvector_forcore[threadid][0][i].c_str();
-		STARTUPINFO si;
-		PROCESS_INFORMATION pi;
+		long long numberofpoints;
+		memcpy(&numberofpoints, &header[247], 8);
+		if (numberofpoints > 0) return numberofpoints;
+	}
+	return legacynumberofpoints;
+}
 
-		ZeroMemory(&si, sizeof(si));
-		si.cb = sizeof(si);
-		ZeroMemory(&pi, sizeof(pi));
+//bounding box of a LAS (or LAZ) file, read from its header, false if the
+//header cannot be read
+bool getlasboundingbox(const string& lasfilename, OGREnvelope* envelope)
+{
+	unsigned char header[227];
+	FILE* file = fopen(lasfilename.c_str(), "rb");
+	if (file == 0) return false;
+	size_t size = fread(header, 1, sizeof(header), file);
+	fclose(file);
+	if (size < sizeof(header) || memcmp(header, "LASF", 4) != 0) return false;
+	memcpy(&envelope->MaxX, &header[179], 8);
+	memcpy(&envelope->MinX, &header[187], 8);
+	memcpy(&envelope->MaxY, &header[195], 8);
+	memcpy(&envelope->MinY, &header[203], 8);
+	return (envelope->MinX <= envelope->MaxX && envelope->MinY <= envelope->MaxY);
+}
+
+//joins the polygons of the SHAPEFILEs to the LAS files, a polygon goes to
+//each LAS file whose bounding box it intersects. joinjobvector gets one job
+//per LAS file. returns false once the error has been reported.
+bool joinpolygons(const vector<string>& lasfilesvector, const vector<string>& shapefilesvector, vector<LASbatchJob>& joinjobvector, bool verbose)
+{
+	size_t l, s, c;
+	joinjobvector.assign(lasfilesvector.size(), LASbatchJob());
+
+	//the bounding boxes of the LAS files, also as polygons for the exact test
+	vector<OGREnvelope> tileenvelopevector(lasfilesvector.size());
+	vector<OGRPolygon> tilepolygonvector(lasfilesvector.size());
+	vector<bool> tilevalidvector(lasfilesvector.size(), false);
+	for (l = 0; l < lasfilesvector.size(); l++)
+	{
+		OGREnvelope& envelope = tileenvelopevector[l];
+		if (!getlasboundingbox(lasfilesvector[l], &envelope))
+		{
+			fprintf(stderr, "WARNING: cannot read the bounding box of '%s', skipping it\n", lasfilesvector[l].c_str());
+			continue;
+		}
+		OGRLinearRing ring;
+		ring.addPoint(envelope.MinX, envelope.MinY);
+		ring.addPoint(envelope.MaxX, envelope.MinY);
+		ring.addPoint(envelope.MaxX, envelope.MaxY);
+		ring.addPoint(envelope.MinX, envelope.MaxY);
+		tilepolygonvector[l].addRing(&ring);
+		tilepolygonvector[l].closeRings();
+		tilevalidvector[l] = true;
+	}
 
-		// Start the child process. 
-		if (!CreateProcess(NULL,   // No module name (use command line)
-			const_cast<char*>(syscommand.c_str()),        // Command line
-			NULL,			// Process handle not inheritable
-			NULL,           // Thread handle not inheritable
-			FALSE,          // Set handle inheritance to FALSE
-			//0,              // No creation flags
-			HIGH_PRIORITY_CLASS,
-			NULL,           // Use parent's environment block
-			lasclipworkingdirstring.c_str(),	// if NULL uses parent's starting directory 
-			&si,            // Pointer to STARTUPINFO structure
-			&pi)           // Pointer to PROCESS_INFORMATION structure
-			)
+	double npolygons = 0, nstraddling = 0, nunjoined = 0;
+	for (s = 0; s < shapefilesvector.size(); s++)
+	{
+		GDALDataset* poDS = (GDALDataset*)GDALOpenEx(shapefilesvector[s].c_str(), GDAL_OF_VECTOR, NULL, NULL, NULL);
+		if (poDS == NULL)
+		{
+			fprintf(stderr, "ERROR: could not open shapefile '%s'\n", shapefilesvector[s].c_str());
+			return false;
+		}
+		OGRLayer* poLayer = poDS->GetLayerByName(getfilenameonly(shapefilesvector[s]).c_str());
+		if (poLayer == NULL)
+		{
+			fprintf(stderr, "ERROR: could not get layer of shapefile '%s' by name\n", shapefilesvector[s].c_str());
+			GDALClose(poDS);
+			return false;
+		}
+		//only the LAS files overlapping the layer are tested feature by feature
+		OGREnvelope layerenvelope;
+		bool haslayerenvelope = (poLayer->GetExtent(&layerenvelope) == OGRERR_NONE);
+		vector<size_t> candidatevector;
+		for (l = 0; l < lasfilesvector.size(); l++)
 		{
-			printf("ERROR: CreateProcess failed (%d).\n", GetLastError());
-			//byebye(true, false);
-			return;
+			if (tilevalidvector[l] && (!haslayerenvelope || layerenvelope.Intersects(tileenvelopevector[l]))) candidatevector.push_back(l);
 		}
+		if (verbose) fprintf(stderr, "'%s' overlaps %d LAS files.\n", shapefilesvector[s].c_str(), (int)candidatevector.size());
 
-		// Wait until child process exits.
-		WaitForSingleObject(pi.hProcess, INFINITE);
+		OGRFeature* poFeature;
+		poLayer->ResetReading();
+		while ((poFeature = poLayer->GetNextFeature()) != NULL)
+		{
+			OGRGeometry* poGeometry = poFeature->GetGeometryRef();
+			if (poGeometry != NULL
+				&& (wkbFlatten(poGeometry->getGeometryType()) == wkbPolygon || wkbFlatten(poGeometry->getGeometryType()) == wkbMultiPolygon))
+			{
+				OGREnvelope envelope;
+				poGeometry->getEnvelope(&envelope);
+				int ntiles = 0;
+				for (c = 0; c < candidatevector.size(); c++)
+				{
+					l = candidatevector[c];
+					if (!envelope.Intersects(tileenvelopevector[l]) || !poGeometry->Intersects(&tilepolygonvector[l])) continue;
+					LASbatchJob& job = joinjobvector[l];
+					if (job.joinshapefiles.empty() || job.joinshapefiles.back() != s)
+					{
+						job.joinshapefiles.push_back(s);
+						job.joinfeatures.push_back(vector<I64>());
+					}
+					job.joinfeatures.back().push_back(poFeature->GetFID());
+					ntiles++;
+				}
+				npolygons++;
+				if (ntiles == 0) nunjoined++;
+				else if (ntiles > 1) nstraddling++;
+			}
+			OGRFeature::DestroyFeature(poFeature);
+		}
+		GDALClose(poDS);
+	}
+	fprintf(stderr, "%.0f polygons joined to LAS files, %.0f of them to several LAS files, %.0f to none.\n", npolygons - nunjoined, nstraddling, nunjoined);
+	return true;
+}
+
+//gathers the polygons joined to the LAS file of the job into a layer of the
+//GDAL memory driver, tagged with fieldindexname as in their SHAPEFILE, or
+//with their feature id when it has no such field. returns the dataset of
+//the layer, 0 once the error has been reported.
+GDALDataset* createjoinlayer(const LASbatchJob& job, OGRLayer** ppoLayer)
+{
+	size_t k, f;
+	GDALDriver* poDriver = GetGDALDriverManager()->GetDriverByName("Memory");
+	if (poDriver == NULL)
+	{
+		fprintf(stderr, "ERROR: GDAL/OGR Memory driver not available\n");
+		return 0;
+	}
+	//the SHAPEFILEs are all opened first, the tag is a string if any of them
+	//tags its polygons with strings
+	vector<GDALDataset*> sourcevector;
+	vector<OGRLayer*> sourcelayervector;
+	vector<int> sourcefieldvector;
+	OGRFieldType tagtype = OFTInteger64;
+	bool failed = false;
+	for (k = 0; k < job.joinshapefiles.size() && !failed; k++)
+	{
+		const string& shapefilename = global_shapefilevector[job.joinshapefiles[k]];
+		GDALDataset* poSourceDS = (GDALDataset*)GDALOpenEx(shapefilename.c_str(), GDAL_OF_VECTOR, NULL, NULL, NULL);
+		OGRLayer* poSourceLayer = (poSourceDS ? poSourceDS->GetLayerByName(getfilenameonly(shapefilename).c_str()) : NULL);
+		if (poSourceLayer == NULL || poSourceLayer->GetLayerDefn() == NULL)
+		{
+			fprintf(stderr, "ERROR: could not read layer of shapefile '%s'\n", shapefilename.c_str());
+			if (poSourceDS) GDALClose(poSourceDS);
+			failed = true;
+			break;
+		}
+		int iField = poSourceLayer->GetLayerDefn()->GetFieldIndex(fieldindexnamestring.c_str());
+		if (iField != -1)
+		{
+			OGRFieldType type = poSourceLayer->GetLayerDefn()->GetFieldDefn(iField)->GetType();
+			if (type != OFTInteger && type != OFTInteger64) tagtype = OFTString;
+		}
+		sourcevector.push_back(poSourceDS);
+		sourcelayervector.push_back(poSourceLayer);
+		sourcefieldvector.push_back(iField);
+	}
+
+	//the tags of the polygons, as strings to find those shared by several
+	//SHAPEFILEs, two of them numbering their polygons from 1 for instance
+	vector<OGRFeature*> sourcefeaturevector;
+	vector<size_t> sourceindexvector;
+	vector<I64> tagvector;
+	vector<string> tagstringvector;
+	std::map<string, size_t> tagsources;
+	bool prefixed = false;
+	for (k = 0; k < sourcelayervector.size() && !failed; k++)
+	{
+		for (f = 0; f < job.joinfeatures[k].size(); f++)
+		{
+			I64 fid = job.joinfeatures[k][f];
+			OGRFeature* poSourceFeature = sourcelayervector[k]->GetFeature(fid);
+			if (poSourceFeature == NULL)
+			{
+				fprintf(stderr, "WARNING: feature %d of '%s' went missing, ignoring it\n", (int)fid, global_shapefilevector[job.joinshapefiles[k]].c_str());
+				continue;
+			}
+			int iField = sourcefieldvector[k];
+			I64 tag = fid;
+			string tagstring;
+			if (iField != -1 && tagtype == OFTString)
+			{
+				tagstring = poSourceFeature->GetFieldAsString(iField);
+			}
+			else
+			{
+				if (iField != -1) tag = poSourceFeature->GetFieldAsInteger64(iField);
+				tagstring = std::to_string((long long)tag);
+			}
+			std::map<string, size_t>::const_iterator it = tagsources.find(tagstring);
+			if (it == tagsources.end()) tagsources[tagstring] = k;
+			else if (it->second != k) prefixed = true;
+			sourcefeaturevector.push_back(poSourceFeature);
+			sourceindexvector.push_back(k);
+			tagvector.push_back(tag);
+			tagstringvector.push_back(tagstring);
+		}
+	}
+	if (prefixed)
+	{
+		//the SHAPEFILE name keeps apart the outputs of their polygons
+		tagtype = OFTString;
+		tagsources.clear();
+		for (f = 0; f < tagstringvector.size() && !failed; f++)
+		{
+			k = sourceindexvector[f];
+			tagstringvector[f] = getfilenameonly(global_shapefilevector[job.joinshapefiles[k]]) + "_" + tagstringvector[f];
+			std::map<string, size_t>::const_iterator it = tagsources.find(tagstringvector[f]);
+			if (it == tagsources.end())
+			{
+				tagsources[tagstringvector[f]] = k;
+			}
+			else if (it->second != k)
+			{
+				fprintf(stderr, "ERROR: polygons of '%s' and '%s' both tagged '%s' for '%s'\n", global_shapefilevector[job.joinshapefiles[it->second]].c_str(), global_shapefilevector[job.joinshapefiles[k]].c_str(), tagstringvector[f].c_str(), job.lasfilename.c_str());
+				failed = true;
+			}
+		}
+		if (!failed && global_verbose) fprintf(stderr, "SHAPEFILEs share tags over '%s', prefixing the tags with their names.\n", job.lasfilename.c_str());
+	}
 
-		// Close process and thread handles. 
-		CloseHandle(pi.hProcess);
-		CloseHandle(pi.hThread);
+	GDALDataset* poDS = (failed ? NULL : poDriver->Create("", 0, 0, 0, GDT_Unknown, NULL));
+	OGRLayer* poLayer = (poDS ? poDS->CreateLayer(getfilenameonly(job.lasfilename).c_str(), NULL, wkbUnknown, NULL) : NULL);
+	OGRFieldDefn fielddefn(fieldindexnamestring.c_str(), tagtype);
+	if (poLayer == NULL || poLayer->CreateField(&fielddefn) != OGRERR_NONE)
+	{
+		if (!failed) fprintf(stderr, "ERROR: could not create the layer of the polygons joined to '%s'\n", job.lasfilename.c_str());
+		if (poDS) GDALClose(poDS);
+		poDS = 0;
+	}
+	for (f = 0; f < sourcefeaturevector.size(); f++)
+	{
+		if (poDS)
+		{
+			OGRFeature* poFeature = OGRFeature::CreateFeature(poLayer->GetLayerDefn());
+			poFeature->SetGeometry(sourcefeaturevector[f]->GetGeometryRef());
+			if (tagtype == OFTString) poFeature->SetField(0, tagstringvector[f].c_str());
+			else poFeature->SetField(0, (GIntBig)tagvector[f]);
+			poLayer->CreateFeature(poFeature);
+			OGRFeature::DestroyFeature(poFeature);
+		}
+		OGRFeature::DestroyFeature(sourcefeaturevector[f]);
 	}
+	for (k = 0; k < sourcevector.size(); k++) GDALClose(sourcevector[k]);
+	*ppoLayer = poLayer;
+	return poDS;
+}
 
+void execute_jobvector(int threadid)
+{
+	//one engine per thread, its buffers are reused by all the jobs of the
+	//thread, its output writer and I/O threads are set up again by every clip.
+	//each engine loads and clips with a single thread, so that -cores bounds
+	//the threads
+	LASclipEngine lasclipengine;
+	lasclipengine.set_field_index_name(fieldindexnamestring.c_str());
+	lasclipengine.set_threads(1);
+	U32 j;
+	while (global_jobscheduler.next(threadid, &j))
+	{
+		const LASbatchJob& job = global_jobvector[j];
+		BOOL clipped = FALSE;
+		if (job.joinshapefiles.size())
+		{
+			OGRLayer* poLayer = 0;
+			GDALDataset* poDS = createjoinlayer(job, &poLayer);
+			if (poDS)
+			{
+				clipped = lasclipengine.clip(job.lasfilename.c_str(), poLayer, job.outputdirname.c_str());
+				GDALClose(poDS);
+			}
+		}
+		else
+		{
+			clipped = lasclipengine.clip(job.lasfilename.c_str(), job.shapefilename.c_str(), job.outputdirname.c_str());
+		}
+		if (!clipped)
+		{
+			fprintf(stderr, "ERROR: clipping '%s' against '%s' failed\n", job.lasfilename.c_str(), job.shapefilename.c_str());
+			global_failedjobs++;
+			continue;
+		}
+		if (!manifeststring.empty()) global_jobmanifest.set_done(job.lasfilename.c_str(), job.shapefilename.c_str(), job.signature, job.outputdirname.c_str());
+		if (global_verbose)
+		{
+#ifdef _WIN32
+			fprintf(stderr, "clipped %I64d points of '%s' against %I64d polygons.\n", lasclipengine.get_number_of_points(), job.lasfilename.c_str(), lasclipengine.get_number_of_polygons());
+#else
+			fprintf(stderr, "clipped %lld points of '%s' against %lld polygons.\n", lasclipengine.get_number_of_points(), job.lasfilename.c_str(), lasclipengine.get_number_of_polygons());
+#endif
+		}
+	}
 }
 
 int main(int argc, char *argv[])
@@ -182,6 +525,9 @@ int main(int argc, char *argv[])
 	//defaults
 	bool verbose = false; // true;
 	int cores = 1;
+	int retries = 0;
+	string jobreportstring;
+	bool spatialjoin = false;
 
 	/*
 	string lasfilesfilterstring;
@@ -223,7 +569,7 @@ int main(int argc, char *argv[])
 		fieldindexnamestring = fieldindex_name;
 
 		CHAR lasclippath[256];
-		fprintf(stderr, "enter lasclip.exe fullpath: "); fgets(lasclippath, 256, stdin);
+		fprintf(stderr, "enter lasclip.exe fullpath (none to clip in-process): "); fgets(lasclippath, 256, stdin);
 		lasclippath[strlen(lasclippath) - 1] = '\0';
 		lasclippathstring = lasclippath;
 
@@ -295,6 +641,10 @@ int main(int argc, char *argv[])
 				byebye(true, argc == 1);
 			}
 		}
+		else if (strcmp(argv[i], "-spatialjoin") == 0)
+		{
+			spatialjoin = true;
+		}
 		else if (strcmp(argv[i], "-matchstringoffset") == 0)
 		{
 			if ((i + 1) >= argc)
@@ -327,7 +677,7 @@ int main(int argc, char *argv[])
 			i++;
 			outputdirstring = argv[i];
 			argv[i][0] = '\0';
-			if (PathIsRelative(outputdirstring.c_str()))
+			if (ispathrelative(outputdirstring))
 			{
 				/*
 				outputdirstring = getpathonly(lasfilesfilterstring) + "\\" + outputdirstring;
@@ -337,7 +687,7 @@ int main(int argc, char *argv[])
 				{
 					laspathonly = getcurrentdirectory();
 				}
-				outputdirstring = laspathonly + "\\" + outputdirstring;
+				outputdirstring = laspathonly + LAS_PATH_SEPARATOR + outputdirstring;
 			}
 		}
 		else if (strcmp(argv[i], "-odirbasedonlas") == 0)
@@ -391,6 +741,40 @@ int main(int argc, char *argv[])
 			unsigned concurentThreadsSupported = thread::hardware_concurrency();
 			//if (cores > concurentThreadsSupported) cores = concurentThreadsSupported; //commented out to leave user fully manage number of concurrent threads
 		}
+		else if (strcmp(argv[i], "-retries") == 0)
+		{
+			if ((i + 1) >= argc)
+			{
+				fprintf(stderr, "ERROR: '%s' needs 1 argument: number\n", argv[i]);
+				usage(true);
+			}
+			i++;
+			retries = atoi(argv[i]);
+			argv[i][0] = '\0';
+			if (retries < 0) retries = 0;
+		}
+		else if (strcmp(argv[i], "-manifest") == 0)
+		{
+			if ((i + 1) >= argc)
+			{
+				fprintf(stderr, "ERROR: '%s' needs 1 argument: string\n", argv[i]);
+				usage(true);
+			}
+			i++;
+			manifeststring = argv[i];
+			argv[i][0] = '\0';
+		}
+		else if (strcmp(argv[i], "-jobreport") == 0)
+		{
+			if ((i + 1) >= argc)
+			{
+				fprintf(stderr, "ERROR: '%s' needs 1 argument: string\n", argv[i]);
+				usage(true);
+			}
+			i++;
+			jobreportstring = argv[i];
+			argv[i][0] = '\0';
+		}
 		else
 		{
 			fprintf(stderr, "ERROR: cannot understand argument '%s'\n", argv[i]);
@@ -414,6 +798,8 @@ int main(int argc, char *argv[])
 	*/
 
 	if (verbose) start_time = taketime();
+	global_verbose = verbose;
+	bool inprocess = lasclippathstring.empty();
 
 	////////////////////////////////////////////
 	// collect multiple LAS (or LAZ) input files
@@ -462,7 +848,7 @@ int main(int argc, char *argv[])
 						if (lasfilesfiltersuffix.empty() || (!lasfilesfiltersuffix.empty() && (thisnamewithoutext.rfind(lasfilesfiltersuffix) == (thisnamewithoutext.size() - lasfilesfiltersuffix.size())) || (thisnamewithoutext.rfind(StringToUpper(lasfilesfiltersuffix)) == (thisnamewithoutext.size() - lasfilesfiltersuffix.size()))))
 						{
 							//if item is not a directory
-							string fullpathname = lasfilesdirectory + "\\" + name;
+							string fullpathname = lasfilesdirectory + LAS_PATH_SEPARATOR + name;
 							if (!isdir(fullpathname.c_str()))
 							{
 								//then we have a complete match, keep this file
@@ -532,7 +918,7 @@ int main(int argc, char *argv[])
 						if (shapefilesfiltersuffix.empty() || (!shapefilesfiltersuffix.empty() && (thisnamewithoutext.rfind(shapefilesfiltersuffix) == (thisnamewithoutext.size() - shapefilesfiltersuffix.size())) || (thisnamewithoutext.rfind(StringToUpper(shapefilesfiltersuffix)) == (thisnamewithoutext.size() - shapefilesfiltersuffix.size()))))
 						{
 							//if item is not a directory
-							string fullpathname = shapefilesdirectory + "\\" + name;
+							string fullpathname = shapefilesdirectory + LAS_PATH_SEPARATOR + name;
 							if (!isdir(fullpathname.c_str()))
 							{
 								//then we have a complete match, keep this file
@@ -563,75 +949,90 @@ int main(int argc, char *argv[])
 		fprintf(stderr, "ERROR: found %d LAS files and found %d SHAPEFILE files\n", lasfilesvector.size(), shapefilesvector.size());
 		byebye(true, argc == 1);
 	}
-	if (lasfilesvector.size() != shapefilesvector.size())
-	{
-		fprintf(stderr, "WARNING: number of LAS files differs from number of SHAPEFILE files\n");
-		fprintf(stderr, "WARNING: found %d LAS files and found %d SHAPEFILE files\n", lasfilesvector.size(),shapefilesvector.size());
-		byebye(true, argc == 1); //byebye(true, argc == 1);
-	}
 	vector<string> shapefilesmatchedvector;
-	if (matchstringoffset < 0) matchstringoffset = 0;
-	if (matchstringlength < -1) matchstringlength = -1;
+	vector<LASbatchJob> joinjobvector;
 	vector<string>::iterator it1;
 	vector<string>::iterator it2;
-	for (it1 = lasfilesvector.begin(); it1 != lasfilesvector.end(); ++it1)
+	if (spatialjoin)
 	{
-		if (matchstringlength != -1 && matchstringlength != 0)
+		//polygons go to the LAS files they overlap, whatever the file names
+		if (!inprocess)
 		{
-			//match string normally
-			string filename = getfilenameonly(*it1);
-			string filenameprefix = filename.substr(matchstringoffset, matchstringlength);
-			for (it2 = shapefilesvector.begin(); it2 != shapefilesvector.end(); ++it2)
+			fprintf(stderr, "ERROR: -spatialjoin clips in-process, it cannot be used with -lasclippath\n");
+			byebye(true, argc == 1);
+		}
+		LASclipEngine::init();
+		global_shapefilevector = shapefilesvector;
+		if (!joinpolygons(lasfilesvector, shapefilesvector, joinjobvector, verbose)) byebye(true, argc == 1);
+	}
+	else
+	{
+		if (lasfilesvector.size() != shapefilesvector.size())
+		{
+			fprintf(stderr, "WARNING: number of LAS files differs from number of SHAPEFILE files\n");
+			fprintf(stderr, "WARNING: found %d LAS files and found %d SHAPEFILE files\n", lasfilesvector.size(),shapefilesvector.size());
+			byebye(true, argc == 1); //byebye(true, argc == 1);
+		}
+		if (matchstringoffset < 0) matchstringoffset = 0;
+		if (matchstringlength < -1) matchstringlength = -1;
+		for (it1 = lasfilesvector.begin(); it1 != lasfilesvector.end(); ++it1)
+		{
+			if (matchstringlength != -1 && matchstringlength != 0)
 			{
-				if ((getfilenameonly(*it2)).find(filenameprefix) == 0)
+				//match string normally
+				string filename = getfilenameonly(*it1);
+				string filenameprefix = filename.substr(matchstringoffset, matchstringlength);
+				for (it2 = shapefilesvector.begin(); it2 != shapefilesvector.end(); ++it2)
 				{
-					//match found
-					shapefilesmatchedvector.push_back(*it2);
-					shapefilesvector.erase(it2);
-					break;
+					if ((getfilenameonly(*it2)).find(filenameprefix) == 0)
+					{
+						//match found
+						shapefilesmatchedvector.push_back(*it2);
+						shapefilesvector.erase(it2);
+						break;
+					}
 				}
 			}
-		}
-		else if (matchstringlength==-1)
-		{
-			//match string length will adapt
-			string filename = getfilenameonly(*it1);
-			if (matchstringoffset > (filename.size() - 1)) matchstringoffset = filename.size() - 1;
-			string filenameprefix = filename.substr(matchstringoffset, filename.size()-matchstringoffset);
-			for (it2 = shapefilesvector.begin(); it2 != shapefilesvector.end(); ++it2)
+			else if (matchstringlength==-1)
 			{
-				if ((getfilenameonly(*it2)).find(filenameprefix) == 0)
+				//match string length will adapt
+				string filename = getfilenameonly(*it1);
+				if (matchstringoffset > (filename.size() - 1)) matchstringoffset = filename.size() - 1;
+				string filenameprefix = filename.substr(matchstringoffset, filename.size()-matchstringoffset);
+				for (it2 = shapefilesvector.begin(); it2 != shapefilesvector.end(); ++it2)
 				{
-					//match found
-					shapefilesmatchedvector.push_back(*it2);
-					shapefilesvector.erase(it2);
-					break;
+					if ((getfilenameonly(*it2)).find(filenameprefix) == 0)
+					{
+						//match found
+						shapefilesmatchedvector.push_back(*it2);
+						shapefilesvector.erase(it2);
+						break;
+					}
 				}
 			}
+			else if (matchstringlength==0)
+			{
+				//no match string used, match in the same order files are found
+				//nothing to do for now, will copy vector as is 
+			}
+			else
+			{
+				fprintf(stderr, "ERROR: unforseen case with matchstringlength %d\n", matchstringlength);
+				byebye(true, argc == 1);
+			}
 		}
-		else if (matchstringlength==0)
+		if (matchstringlength==0)
 		{
-			//no match string used, match in the same order files are found
-			//nothing to do for now, will copy vector as is 
+			//copy vector
+			shapefilesmatchedvector = shapefilesvector;
 		}
-		else
+		if (lasfilesvector.size() != shapefilesmatchedvector.size())
 		{
-			fprintf(stderr, "ERROR: unforseen case with matchstringlength %d\n", matchstringlength);
-			byebye(true, argc == 1);
+			fprintf(stderr, "WARNING: number of LAS files differs from number of matched SHAPEFILE files\n");
+			fprintf(stderr, "WARNING: found %d LAS files and found %d matching SHAPEFILE files\n", lasfilesvector.size(), shapefilesmatchedvector.size());
+			byebye(true, argc == 1); //byebye(true, argc == 1);
 		}
 	}
-	if (matchstringlength==0)
-	{
-		//copy vector
-		shapefilesmatchedvector = shapefilesvector;
-	}
-	if (lasfilesvector.size() != shapefilesmatchedvector.size())
-	{
-		fprintf(stderr, "WARNING: number of LAS files differs from number of matched SHAPEFILE files\n");
-		fprintf(stderr, "WARNING: found %d LAS files and found %d matching SHAPEFILE files\n", lasfilesvector.size(), shapefilesmatchedvector.size());
-		byebye(true, argc == 1); //byebye(true, argc == 1);
-	}
-
 
 	////////////////////////////
 	//construct outputdir vector
@@ -657,14 +1058,14 @@ int main(int argc, char *argv[])
 		{
 			//option basedonlas, new dir will be created using las file names
 			/*
-			outputdirvector.push_back(getpathonly(lasfilesfilterstring) + "\\" + getfilenameonly(*it));
+			outputdirvector.push_back(getpathonly(lasfilesfilterstring) + LAS_PATH_SEPARATOR + getfilenameonly(*it));
 			*/
 			string laspathonly = getpathonly(lasfilesfilterstring);
 			if (laspathonly.empty())
 			{
 				laspathonly = getcurrentdirectory();
 			}
-			outputdirvector.push_back(laspathonly + "\\" + getfilenameonly(*it));
+			outputdirvector.push_back(laspathonly + LAS_PATH_SEPARATOR + getfilenameonly(*it));
 		}
 		else
 		{
@@ -672,54 +1073,179 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	////////////////////////////
-	//construct system cmd lines
-	////////////////////////////
-	string quote = "\"";
-	string syscommand;
-	vector<string> syscommandvector;
+	/////////////////////////////////////
+	//construct jobs and system cmd lines
+	/////////////////////////////////////
 	//vector<string>::iterator it1;
 	//vector<string>::iterator it2;
 	vector<string>::iterator it3;
 	//for (it1 = lasfilesvector.begin(), it2 = shapefilesvector.begin(), it3 = outputdirvector.begin(); it1 != lasfilesvector.end() && it2 != shapefilesvector.end() && it3 != outputdirvector.end(); ++it1, ++it2, ++it3)
+	for (size_t l = 0; l < joinjobvector.size(); l++)
+	{
+		//LAS files without any polygon are left alone
+		LASbatchJob& job = joinjobvector[l];
+		if (job.joinshapefiles.empty()) continue;
+		job.lasfilename = lasfilesvector[l];
+		job.outputdirname = outputdirvector[l];
+		for (size_t k = 0; k < job.joinshapefiles.size(); k++)
+		{
+			if (k) job.shapefilename += ";";
+			job.shapefilename += shapefilesvector[job.joinshapefiles[k]];
+		}
+		global_jobvector.push_back(job);
+	}
 	for (it1 = lasfilesvector.begin(), it2 = shapefilesmatchedvector.begin(), it3 = outputdirvector.begin(); it1 != lasfilesvector.end() && it2 != shapefilesmatchedvector.end() && it3 != outputdirvector.end(); ++it1, ++it2, ++it3)
 	{
-		syscommand = quote + lasclippathstring + quote + " -i " + quote + *it1 + quote + " -poly " + quote + *it2 + quote + " -odir " + quote + *it3 + quote + " -fieldindexname " + fieldindexnamestring;
-		if(verbose) fprintf(stderr, "%s\n", syscommand.c_str());
-		syscommandvector.push_back(syscommand);
+		LASbatchJob job;
+		job.lasfilename = *it1;
+		job.shapefilename = *it2;
+		job.outputdirname = *it3;
+		if (!inprocess)
+		{
+			job.syscommand.push_back(lasclippathstring);
+			job.syscommand.push_back("-i");
+			job.syscommand.push_back(*it1);
+			job.syscommand.push_back("-poly");
+			job.syscommand.push_back(*it2);
+			job.syscommand.push_back("-odir");
+			job.syscommand.push_back(*it3);
+			job.syscommand.push_back("-fieldindexname");
+			job.syscommand.push_back(fieldindexnamestring);
+		}
+		global_jobvector.push_back(job);
 	}
 
-	////////////////////////////////////////
-	//distribute system cmd lines over cores
-	////////////////////////////////////////
-	if (cores > syscommandvector.size()) cores = syscommandvector.size();
-	//vector<vector<string>*> global_psyscommandvector_forcore;
-	for (i = 0; i < cores; i++)
+	//////////////////////////////////////////////
+	//skip jobs completed by a previous run as is
+	//////////////////////////////////////////////
+	if (!manifeststring.empty())
 	{
-		vector<string>* psyscommandvector = new vector<string>;
-		if (psyscommandvector) global_psyscommandvector_forcore.push_back(psyscommandvector);
-		else 
+		if (!global_jobmanifest.open(manifeststring.c_str()))
 		{
-			fprintf(stderr, "ERROR: allocating vector<string>\n");
+			fprintf(stderr, "ERROR: cannot use manifest '%s'\n", manifeststring.c_str());
 			byebye(true, argc == 1);
 		}
+		string options = "-fieldindexname " + fieldindexnamestring;
+		vector<LASbatchJob> jobvector;
+		for (size_t j = 0; j < global_jobvector.size(); j++)
+		{
+			LASbatchJob& job = global_jobvector[j];
+			if (job.joinshapefiles.empty())
+			{
+				job.signature = LASjobManifest::signature(job.lasfilename.c_str(), job.shapefilename.c_str(), options.c_str());
+			}
+			else
+			{
+				//the polygons joined depend on all the SHAPEFILEs of the join
+				for (size_t k = 0; k < job.joinshapefiles.size(); k++)
+				{
+					string signature = LASjobManifest::signature(job.lasfilename.c_str(), global_shapefilevector[job.joinshapefiles[k]].c_str(), (k + 1 < job.joinshapefiles.size() ? ";" : options.c_str()));
+					if (signature.empty())
+					{
+						job.signature.clear();
+						break;
+					}
+					job.signature += signature;
+				}
+			}
+			if (global_jobmanifest.is_up_to_date(job.lasfilename.c_str(), job.shapefilename.c_str(), job.signature, job.outputdirname.c_str()))
+			{
+				if (verbose) fprintf(stderr, "'%s' is up to date, skipping it.\n", job.lasfilename.c_str());
+			}
+			else
+			{
+				jobvector.push_back(job);
+			}
+		}
+		fprintf(stderr, "%d of %d LAS files are up to date according to '%s'\n", (int)(global_jobvector.size() - jobvector.size()), (int)global_jobvector.size(), manifeststring.c_str());
+		global_jobvector.swap(jobvector);
+		if (global_jobvector.empty()) byebye(false, argc == 1);
 	}
-	//for each core, a list of system cmd lines is prepared
-	i = -1;
-	//vector<string>::iterator it;
-	for (it = syscommandvector.begin(); it != syscommandvector.end(); ++it)
+
+	//////////////////////////////////////////
+	//schedule jobs over cores, largest first
+	//////////////////////////////////////////
+	if (cores > global_jobvector.size()) cores = global_jobvector.size();
+	//the cost of a job is the number of points of its LAS file, the threads
+	//(or children) start with the largest files and those done early take
+	//over the jobs left to the others
+	vector<I64> jobcostvector(global_jobvector.size());
+	for (size_t j = 0; j < global_jobvector.size(); j++)
 	{
-		i++;
-		if (i == cores) i = 0;
-		global_psyscommandvector_forcore[i]->push_back(*it);
+		jobcostvector[j] = getlasnumberofpoints(global_jobvector[j].lasfilename);
 	}
+	if (inprocess) global_jobscheduler.setup(jobcostvector, cores);
+
 
+	/////////////////////////////////////////////////
+	//launch lasclip, at most one child per core at once
+	/////////////////////////////////////////////////
+	if (!inprocess)
+	{
+		//a single queue, largest first, each core takes the next job once its
+		//child has ended
+		vector<int> joborder(global_jobvector.size());
+		for (int j = 0; j < (int)joborder.size(); j++) joborder[j] = j;
+		std::stable_sort(joborder.begin(), joborder.end(), [&jobcostvector](int a, int b) { return jobcostvector[a] > jobcostvector[b]; });
+		vector< vector<string> > syscommandvector;
+		for (int j = 0; j < (int)joborder.size(); j++) syscommandvector.push_back(global_jobvector[joborder[j]].syscommand);
+
+		LASlauncher laslauncher;
+		laslauncher.set_max_children(cores);
+		laslauncher.set_retries(retries);
+		laslauncher.set_working_directory(lasclipworkingdirstring.c_str());
+		laslauncher.set_verbose(verbose);
+		if (!manifeststring.empty())
+		{
+			//recorded as each child completes, so that a batch interrupted
+			//midway only redoes the jobs it did not complete
+			laslauncher.set_on_done([&joborder](size_t c, const LASlaunchResult& result)
+			{
+				const LASbatchJob& job = global_jobvector[joborder[c]];
+				if (result.exit_code == 0) global_jobmanifest.set_done(job.lasfilename.c_str(), job.shapefilename.c_str(), job.signature, job.outputdirname.c_str());
+			});
+		}
+		vector<LASlaunchResult> launchresultvector;
+		global_failedjobs = laslauncher.run(syscommandvector, launchresultvector);
 
-	//////////////////////////
-	//execute system cmd lines
-	//////////////////////////
+		if (!jobreportstring.empty())
+		{
+			FILE* file = fopen(jobreportstring.c_str(), "w");
+			if (file == 0)
+			{
+				fprintf(stderr, "ERROR: could not open job report '%s'\n", jobreportstring.c_str());
+			}
+			else
+			{
+				fprintf(file, "las_file,shape_file,points,exit_code,attempts,wall_time,user_time,system_time,max_rss_kb\n");
+				for (int j = 0; j < (int)joborder.size(); j++)
+				{
+					const LASbatchJob& job = global_jobvector[joborder[j]];
+					const LASlaunchResult& result = launchresultvector[j];
+					fprintf(file, "%s,%s,%.0f,%d,%d,%.3f,%.3f,%.3f,%.0f\n", job.lasfilename.c_str(), job.shapefilename.c_str(), (double)jobcostvector[joborder[j]], result.exit_code, result.attempts, result.wall_time, result.user_time, result.system_time, (double)result.max_rss);
+				}
+				fclose(file);
+			}
+		}
+		if (verbose)
+		{
+			for (int j = 0; j < (int)joborder.size(); j++)
+			{
+				const LASlaunchResult& result = launchresultvector[j];
+				fprintf(stderr, "'%s' exited with %d after %d attempt(s), %.3f sec. user, %.3f sec. sys, %.0f KB peak.\n", global_jobvector[joborder[j]].lasfilename.c_str(), result.exit_code, result.attempts, result.user_time, result.system_time, (double)result.max_rss);
+			}
+		}
+	}
+
+	//////////////
+	//execute jobs
+	//////////////
+	//GDAL/OGR drivers are registered once for all in-process jobs
+	if (inprocess) LASclipEngine::init();
+	//the launcher already ran the lasclip.exe jobs
+	int nthreads = (inprocess ? cores : 0);
 	vector<thread*> pthreadvector;
-	for (i = 0; i < cores; i++)
+	for (i = 0; i < nthreads; i++)
 	{
 		//creates one thread per core
 		thread* pthread = new thread;
@@ -729,8 +1255,8 @@ int main(int argc, char *argv[])
 			fprintf(stderr, "ERROR: allocating thread\n");
 			byebye(true, argc == 1);
 		}
-		//each thread executes its assigned serie of system cmd lines
-		*pthread = thread(execute_syscommandvector, i);
+		//each thread executes the jobs the scheduler hands it
+		*pthread = thread(execute_jobvector, i);
 		/*
 		if (!SetThreadPriority(pthread->native_handle(), THREAD_PRIORITY_HIGHEST)) //THREAD_PRIORITY_TIME_CRITICAL
 		{
@@ -742,7 +1268,7 @@ int main(int argc, char *argv[])
 	////////////////////////////////
 	//wait for all threads to finish
 	////////////////////////////////
-	for (i = 0; i < cores; i++)
+	for (i = 0; i < nthreads; i++)
 	{
 		pthreadvector[i]->join();
 	}
@@ -751,24 +1277,29 @@ int main(int argc, char *argv[])
 	//exit gracefully
 	/////////////////
 	//delete dynamically allocated objects
-	for (i = 0; i < cores; i++)
+	for (i = 0; i < nthreads; i++)
 	{
-		//delete vector<string>*
-		if (global_psyscommandvector_forcore[i]) delete global_psyscommandvector_forcore[i];
-
 		//delete thread*
 		if (pthreadvector[i]) delete pthreadvector[i];
 	}
+	//the last completed jobs are counted and recorded
+	if (!manifeststring.empty()) global_jobmanifest.close();
 #ifdef _WIN64
-	if (verbose) fprintf(stderr, "called lasclip.exe %I64d times over %I64d cores took %g sec.\n", syscommandvector.size(), cores, taketime() - start_time);
+	if (verbose) fprintf(stderr, "%s %I64d times over %d cores took %g sec.\n", (inprocess ? "clipped in-process" : "called lasclip.exe"), global_jobvector.size(), cores, taketime() - start_time);
 #else
 #ifdef _WIN32
-	if (verbose) fprintf(stderr, "called lasclip.exe %d times over %d cores took %f sec.\n", syscommandvector.size(), cores, taketime() - start_time);
+	if (verbose) fprintf(stderr, "%s %d times over %d cores took %f sec.\n", (inprocess ? "clipped in-process" : "called lasclip.exe"), global_jobvector.size(), cores, taketime() - start_time);
 #else
-	if (verbose) fprintf(stderr, "called lasclip.exe  %lld times over %lld cores took %g sec.\n", syscommandvector.size(), cores, taketime() - start_time);
+	if (verbose) fprintf(stderr, "%s %zu times over %d cores took %g sec.\n", (inprocess ? "clipped in-process" : "called lasclip.exe"), global_jobvector.size(), cores, taketime() - start_time);
 #endif
 #endif
 
+	if (verbose && inprocess) fprintf(stderr, "%u jobs taken over between cores.\n", global_jobscheduler.get_number_of_steals());
+	if (global_failedjobs > 0)
+	{
+		fprintf(stderr, "ERROR: %d of %d LAS files could not be clipped\n", (int)global_failedjobs, (int)global_jobvector.size());
+		byebye(true, argc == 1);
+	}
 	byebye(false, argc == 1);
 	return 0;
 }
@@ -0,0 +1,209 @@
+/*
+===============================================================================
+
+FILE:  lasboundedqueue.h
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+Bounded lock-free queue connecting the stages of a pipeline, for several
+producers and several consumers. Each slot carries a sequence number that
+tells producers and consumers whose turn it is (after Dmitry Vyukov's
+bounded MPMC queue), so that a push or a pop is one compare-and-swap in
+the common case. push() waits while the queue is full, which throttles a
+stage running ahead of the next one, and pop() waits while it is empty.
+Waiting spins for a short while, then sleeps on a condition variable so
+that idle stages do not burn a core while the reader waits on the disk.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- push() and pop() sleep instead of spinning once the wait gets long
+17 October 2026 -- created for the lasclip single pass pipeline
+
+===============================================================================
+*/
+
+#ifndef LAS_BOUNDED_QUEUE_H
+#define LAS_BOUNDED_QUEUE_H
+
+#include "mydefs.hpp"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//tries of push() and pop() before they sleep
+#define LAS_BOUNDED_QUEUE_SPINS 64
+
+template <class T>
+class LASboundedQueue
+{
+public:
+	//the capacity is rounded up to a power of two
+	LASboundedQueue(const U32 capacity)
+	{
+		size_t size = 2;
+		while (size < capacity) size <<= 1;
+		mask = size - 1;
+		slots = new LASslot[size];
+		for (size_t s = 0; s < size; s++) slots[s].sequence.store(s, std::memory_order_relaxed);
+		enqueue_pos.store(0, std::memory_order_relaxed);
+		dequeue_pos.store(0, std::memory_order_relaxed);
+		push_waiters.store(0, std::memory_order_relaxed);
+		pop_waiters.store(0, std::memory_order_relaxed);
+	};
+	~LASboundedQueue() { delete [] slots; };
+
+	//returns FALSE instead of waiting when the queue is full
+	BOOL try_push(const T& item)
+	{
+		size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+		while (true)
+		{
+			LASslot* slot = &slots[pos & mask];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			if (sequence == pos)
+			{
+				if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					slot->item = item;
+					slot->sequence.store(pos + 1, std::memory_order_release);
+					return TRUE;
+				}
+			}
+			else if (sequence < pos)
+			{
+				return FALSE;
+			}
+			else
+			{
+				pos = enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+	};
+
+	//returns FALSE instead of waiting when the queue is empty
+	BOOL try_pop(T* item)
+	{
+		size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+		while (true)
+		{
+			LASslot* slot = &slots[pos & mask];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			if (sequence == pos + 1)
+			{
+				if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					*item = slot->item;
+					slot->sequence.store(pos + mask + 1, std::memory_order_release);
+					return TRUE;
+				}
+			}
+			else if (sequence < pos + 1)
+			{
+				return FALSE;
+			}
+			else
+			{
+				pos = dequeue_pos.load(std::memory_order_relaxed);
+			}
+		}
+	};
+
+	void push(const T& item)
+	{
+		U32 spins = 0;
+		while (!try_push(item))
+		{
+			if (spins++ < LAS_BOUNDED_QUEUE_SPINS)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			//the waiter is counted before trying again, so a pop() either
+			//sees it and wakes it up or frees the slot before the try
+			std::unique_lock<std::mutex> lock(mutex);
+			push_waiters.fetch_add(1);
+			while (!try_push(item)) not_full.wait(lock);
+			push_waiters.fetch_sub(1);
+			break;
+		}
+		wake(pop_waiters, not_empty);
+	};
+	void pop(T* item)
+	{
+		U32 spins = 0;
+		while (!try_pop(item))
+		{
+			if (spins++ < LAS_BOUNDED_QUEUE_SPINS)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(mutex);
+			pop_waiters.fetch_add(1);
+			while (!try_pop(item)) not_empty.wait(lock);
+			pop_waiters.fetch_sub(1);
+			break;
+		}
+		wake(push_waiters, not_full);
+	};
+
+protected:
+	//wakes up the sleepers of the other side, if any, after a push or a pop
+	inline void wake(std::atomic<U32>& waiters, std::condition_variable& condition)
+	{
+		//orders the slot just written before the read of the waiters
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waiters.load() == 0) return;
+		std::lock_guard<std::mutex> lock(mutex);
+		condition.notify_all();
+	};
+	struct LASslot
+	{
+		std::atomic<size_t> sequence;
+		T item;
+	};
+	LASslot* slots;
+	size_t mask;
+	//producers and consumers move apart, each on its own cache line
+	char pad0[64];
+	std::atomic<size_t> enqueue_pos;
+	char pad1[64];
+	std::atomic<size_t> dequeue_pos;
+	char pad2[64];
+	//sleepers, only touched once the spinning is over
+	std::mutex mutex;
+	std::condition_variable not_full;
+	std::condition_variable not_empty;
+	std::atomic<U32> push_waiters;
+	std::atomic<U32> pop_waiters;
+};
+
+#endif
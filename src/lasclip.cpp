@@ -35,6 +35,34 @@
   
   CHANGE HISTORY:
   
+	17 October 2026 -- -buildlax kept with -max_memory when the points fit in it
+	17 October 2026 -- -ramindex and -threads outputs keep the order of the points in the file
+	17 October 2026 -- points loaded by the -threads threads, one by default
+	17 October 2026 -- -container polygons spill to disk, not kept in memory until closed
+	17 October 2026 -- -singlepass outputs past 256 deferred, -max_memory counts their buffers
+	17 October 2026 -- -exact_size outputs spill to disk, not kept in memory until closed
+	17 October 2026 -- -singlepass writes outputs during the pass, its buckets kept under -max_memory
+	17 October 2026 -- clipping moved to class LASclipEngine, shared with lasbatchclip
+	17 October 2026 -- builds on Linux too, for the launcher of lasbatchclip
+	17 October 2026 -- -max_memory buckets opened 256 at a time, in a scratch directory
+	17 October 2026 -- LAX built in-process only with -buildlax or -writelax
+	17 October 2026 -- added -exact_size option, outputs written once to their final size
+	17 October 2026 -- added -olaz option, LAZ outputs compressed by the I/O threads
+	17 October 2026 -- added -container option, all outputs in one LAS file
+	17 October 2026 -- outputs written behind by I/O threads, added -io_threads
+	17 October 2026 -- single pass run as a read, classify and bucket pipeline
+	17 October 2026 -- threads scheduled heaviest polygon first, with work stealing
+	17 October 2026 -- threads query the points through LASrectangleQuery, LAX included
+	17 October 2026 -- added -threads option, polygons clipped on several threads
+	17 October 2026 -- added -max_memory option, out-of-core clipping through bucket files
+	17 October 2026 -- added -mmap option, uncompressed LAS points mapped in place
+	17 October 2026 -- LAX built in-process when missing, added -writelax and -laxdir
+	17 October 2026 -- added -ramindex option, a cell index built in RAM
+	17 October 2026 -- polygons tested in the quantized space of the points
+	17 October 2026 -- RAM scans read the X and Y columns of LASreaderLASRAM
+	17 October 2026 -- candidate points tested by blocks with SIMD kernels
+	17 October 2026 -- replaced OGRPoint::Within() by class LASpolygon
+	17 October 2026 -- added -singlepass option and class LASpolygonIndex
 	23 April 2017 -- added class LASreadOpenerRAM and class LASreaderLASRAM
      3 April 2017 -- created in Benoit St-Onge's Lab at UQAM in Montreal
 
@@ -46,19 +74,19 @@
 #include <string.h>
 
 #include "lasreader.hpp"
-#include "laswaveform13reader.hpp"
-#include "laswriter.hpp"
 
-#include "lasreadopenerram.h"
-#include "lasreaderlasram.h"
+#include "lasclipengine.h"
 
-#include "ogrsf_frmts.h"
 //#include <string>
 //using namespace std;
-#include <windows.h> //for direxists()
-#include <Shlwapi.h> //for PathIsRelative()
 #include "lasappsutility.h"
-#include <iostream> //for term_progress()
+#ifdef _WIN32
+#include <direct.h> //for _mkdir()
+#else
+#include <sys/stat.h> //for mkdir()
+#define _mkdir(dirname) mkdir(dirname, 0777)
+#endif
+#include <thread>
 
 void usage(bool error=false, bool wait=false)
 {
@@ -80,6 +108,75 @@ void usage(bool error=false, bool wait=false)
   fprintf(stderr,"                polygon index will be used to tag LAS ouput\n");
   fprintf(stderr,"                files. The field index name should be unique\n");
   fprintf(stderr,"                for each polygon.\n");
+  fprintf(stderr,"-singlepass flag is optional, if used the LAS input file is\n");
+  fprintf(stderr,"            read only once for all polygons instead of once\n");
+  fprintf(stderr,"            per polygon, the clipped points of a polygon are\n");
+  fprintf(stderr,"            held in memory until they fill an I/O buffer,\n");
+  fprintf(stderr,"            then written to its file for at most 256 polygons\n");
+  fprintf(stderr,"            at once, to a spill file of a scratch directory\n");
+  fprintf(stderr,"            for the others until they are closed. The points\n");
+  fprintf(stderr,"            held, whether bucketed or buffered, are all handed\n");
+  fprintf(stderr,"            over once they exceed -max_memory.\n");
+  fprintf(stderr,"-ramindex flag is optional, if used and no LAX file exists,\n");
+  fprintf(stderr,"          the points loaded in memory are reordered cell by\n");
+  fprintf(stderr,"          cell and indexed so that each polygon only scans\n");
+  fprintf(stderr,"          the points of the cells overlapping its envelope.\n");
+  fprintf(stderr,"          The outputs keep the order of the points in the\n");
+  fprintf(stderr,"          file, at the cost of 4 more bytes per point.\n");
+  fprintf(stderr,"-mmap flag is optional, if used the points of an uncompressed\n");
+  fprintf(stderr,"      LAS input file (point formats 0 to 5) are mapped in\n");
+  fprintf(stderr,"      memory in place instead of being copied, compressed\n");
+  fprintf(stderr,"      and other files are still loaded in memory.\n");
+  fprintf(stderr,"-threads flag is optional, it specifies the number of threads\n");
+  fprintf(stderr,"         clipping polygons against the points loaded in\n");
+  fprintf(stderr,"         memory (64 bit version), which also load them,\n");
+  fprintf(stderr,"         one by default. Without LAX file, the points are\n");
+  fprintf(stderr,"         indexed as with -ramindex, the outputs are the\n");
+  fprintf(stderr,"         same as with one thread.\n");
+  fprintf(stderr,"         With -singlepass, it specifies the number of threads\n");
+  fprintf(stderr,"         testing the points while the next ones are read.\n");
+  fprintf(stderr,"-max_memory flag is optional, it specifies the memory budget\n");
+  fprintf(stderr,"            in MB. If the points do not fit in it, they are\n");
+  fprintf(stderr,"            spilled into bucket files of groups of nearby\n");
+  fprintf(stderr,"            polygons, 256 buckets per pass, in a scratch\n");
+  fprintf(stderr,"            directory of the output directory, then clipped\n");
+  fprintf(stderr,"            bucket by bucket.\n");
+  fprintf(stderr,"-olaz flag is optional, if used the output files are written\n");
+  fprintf(stderr,"      compressed as LAZ files, by one or more I/O threads,\n");
+  fprintf(stderr,"      one per hardware thread by default. -olas is the\n");
+  fprintf(stderr,"      default.\n");
+  fprintf(stderr,"-container flag is optional, if used all clipped points are\n");
+  fprintf(stderr,"           written to one LAS file, polygon after polygon,\n");
+  fprintf(stderr,"           with the polygon number in point_source_ID, and\n");
+  fprintf(stderr,"           a CSV table gives the first point and the number\n");
+  fprintf(stderr,"           of points of each polygon. The points of a\n");
+  fprintf(stderr,"           polygon beyond -io_buffer wait in a spill file\n");
+  fprintf(stderr,"           of a scratch directory until it is closed.\n");
+  fprintf(stderr,"-exact_size flag is optional, if used each output file is\n");
+  fprintf(stderr,"            written once, in one sequential pass, with its\n");
+  fprintf(stderr,"            final header and size (uncompressed point formats\n");
+  fprintf(stderr,"            0 to 5), instead of being patched afterwards.\n");
+  fprintf(stderr,"            the points of an output beyond -io_buffer wait\n");
+  fprintf(stderr,"            in a spill file of a scratch directory until\n");
+  fprintf(stderr,"            it is closed, they are written twice then.\n");
+  fprintf(stderr,"-io_threads flag is optional, it specifies the number of threads\n");
+  fprintf(stderr,"            writing the LAS output files in the background,\n");
+  fprintf(stderr,"            the default is 2 (one per hardware thread with\n");
+  fprintf(stderr,"            -olaz), 0 writes them while clipping.\n");
+  fprintf(stderr,"-io_buffer flag is optional, it specifies in KB the size of\n");
+  fprintf(stderr,"           the buffers handed over to the writing threads,\n");
+  fprintf(stderr,"           the default is 1024.\n");
+  fprintf(stderr,"-io_max_memory flag is optional, it specifies in MB how much\n");
+  fprintf(stderr,"               memory the buffers waiting to be written may\n");
+  fprintf(stderr,"               take before clipping waits, the default is 256.\n");
+  fprintf(stderr,"-buildlax flag is optional, if used a LAX file is built in\n");
+  fprintf(stderr,"          memory when none exists, which reads the LAS input\n");
+  fprintf(stderr,"          file twice but pays off with many polygons. It is\n");
+  fprintf(stderr,"          not built when the points exceed -max_memory.\n");
+  fprintf(stderr,"-writelax flag is optional, it implies -buildlax and the LAX\n");
+  fprintf(stderr,"          file built is written beside the LAS input file.\n");
+  fprintf(stderr,"-laxdir flag is optional, it specifies a directory where LAX\n");
+  fprintf(stderr,"        files are looked for and written when built.\n");
   fprintf(stderr,"-verbose flag is optional, if used it details the process.\n");
   fprintf(stderr,"-h flag is used to produce this usage help screen.\n");
   fprintf(stderr,"----------------------------------------------------------------------------\n");
@@ -87,7 +184,10 @@ void usage(bool error=false, bool wait=false)
   fprintf(stderr,"One can generate this LAX file using LAStools' lasindex.exe and\n");
   fprintf(stderr,"the LAX filename should be identical to the LAS input file for \n");
   fprintf(stderr,"lasclip process to be accelerated. For example, using test.lax\n");
-  fprintf(stderr,"along with test.las and test.shp.\n");
+  fprintf(stderr,"along with test.las and test.shp. Without LAX file, -buildlax\n");
+  fprintf(stderr,"builds the same index in memory before clipping, see -writelax\n");
+  fprintf(stderr,"and -laxdir to keep it for the next runs. The -ramindex flag\n");
+  fprintf(stderr,"replaces it by an index of the points reordered in memory.\n");
   fprintf(stderr,"----------------------------------------------------------------------------\n");
   fprintf(stderr,"There is no reprojection support in LASapps lasclip version 0.1.\n");
   fprintf(stderr,"The same SRS is expected to be used for both the LAS file and \n");
@@ -104,25 +204,31 @@ void usage(bool error=false, bool wait=false)
   exit(error);
 }
 
-
-
 int main(int argc, char *argv[])
 {
   int i;
   bool verbose = false; // true;
+  bool singlepass = false;
+  bool ramindex = false;
+  bool buildlax = false;
+  bool writelax = false;
+  bool mappoints = false;
+  bool container = false;
+  bool exactsize = false;
+  I64 maxmemory = 0;
+  U32 nthreads = 1;
+  U32 iothreads = 2;
+  bool iothreadsset = false;
+  U32 iobuffer = 1048576;
+  I64 ioinflight = 256 * 1048576;
+  std::string laxdirname;
   CHAR separator_sign = ' ';
   CHAR* separator = "space";
-  double start_time = 0.0;
 
-#ifdef LASCLIP_RAM
-  LASreadOpenerRAM lasreadopener;
-#else
+  //only lists the input files, each one is opened by the engine
   LASreadOpener lasreadopener;
-#endif
 
-  LASwriteOpener laswriteopener;
-  //laswriteopener.set_format("txt");
-  laswriteopener.set_format("las");
+  const CHAR* outputformat = "las";
 
   std::string shapefilename;
   std::string shapefilelayername;
@@ -177,7 +283,7 @@ int main(int argc, char *argv[])
   {
     for (i = 1; i < argc; i++)
     {
-      if (argv[i][0] == '') argv[i][0] = '-';
+      if (argv[i][0] == '') argv[i][0] = '-';
     }
   }
 
@@ -201,6 +307,43 @@ int main(int argc, char *argv[])
     {
       verbose = true;
     }
+    else if (strcmp(argv[i],"-singlepass") == 0)
+    {
+      singlepass = true;
+    }
+    else if (strcmp(argv[i],"-ramindex") == 0)
+    {
+      ramindex = true;
+    }
+    else if (strcmp(argv[i],"-buildlax") == 0)
+    {
+      buildlax = true;
+    }
+    else if (strcmp(argv[i],"-writelax") == 0)
+    {
+      buildlax = true;
+      writelax = true;
+    }
+    else if (strcmp(argv[i],"-mmap") == 0)
+    {
+      mappoints = true;
+    }
+    else if (strcmp(argv[i],"-container") == 0)
+    {
+      container = true;
+    }
+    else if (strcmp(argv[i],"-exact_size") == 0)
+    {
+      exactsize = true;
+    }
+    else if (strcmp(argv[i],"-olaz") == 0)
+    {
+      outputformat = "laz";
+    }
+    else if (strcmp(argv[i],"-olas") == 0)
+    {
+      outputformat = "las";
+    }
     else if (strcmp(argv[i],"-version") == 0)
     {
 		fprintf(stderr, "LASapps lasclip version 0.1\n");
@@ -245,7 +388,7 @@ int main(int argc, char *argv[])
 		i++;
 		outputdirname = argv[i];
 		argv[i][0] = '\0';
-		if (PathIsRelative(outputdirname.c_str()))
+		if (ispathrelative(outputdirname))
 		{
 			/*
 			outputdirname = getpathonly(lasreadopener.get_file_name()) + "\\" + outputdirname;
@@ -255,8 +398,95 @@ int main(int argc, char *argv[])
 			{
 				laspathonly = getcurrentdirectory();
 			}
-			outputdirname = laspathonly + "\\" + outputdirname;
+			outputdirname = laspathonly + LAS_PATH_SEPARATOR + outputdirname;
+		}
+	}
+	else if (strcmp(argv[i], "-threads") == 0)
+	{
+		if ((i + 1) >= argc)
+		{
+			fprintf(stderr, "ERROR: '%s' needs 1 argument: number of threads\n", argv[i]);
+			usage(true);
+		}
+		i++;
+		if (atoi(argv[i]) < 1)
+		{
+			fprintf(stderr, "ERROR: '%s' is not a valid number of threads\n", argv[i]);
+			usage(true);
+		}
+		nthreads = (U32)atoi(argv[i]);
+	}
+	else if (strcmp(argv[i], "-io_threads") == 0)
+	{
+		if ((i + 1) >= argc)
+		{
+			fprintf(stderr, "ERROR: '%s' needs 1 argument: number of threads\n", argv[i]);
+			usage(true);
+		}
+		i++;
+		if (atoi(argv[i]) < 0)
+		{
+			fprintf(stderr, "ERROR: '%s' is not a valid number of threads\n", argv[i]);
+			usage(true);
 		}
+		iothreads = (U32)atoi(argv[i]);
+		iothreadsset = true;
+	}
+	else if (strcmp(argv[i], "-io_buffer") == 0)
+	{
+		if ((i + 1) >= argc)
+		{
+			fprintf(stderr, "ERROR: '%s' needs 1 argument: number of KB\n", argv[i]);
+			usage(true);
+		}
+		i++;
+		if (atoi(argv[i]) < 1 || atoi(argv[i]) > 1048576)
+		{
+			fprintf(stderr, "ERROR: '%s' is not a valid buffer size\n", argv[i]);
+			usage(true);
+		}
+		iobuffer = (U32)atoi(argv[i]) * 1024;
+	}
+	else if (strcmp(argv[i], "-io_max_memory") == 0)
+	{
+		if ((i + 1) >= argc)
+		{
+			fprintf(stderr, "ERROR: '%s' needs 1 argument: number of MB\n", argv[i]);
+			usage(true);
+		}
+		i++;
+		ioinflight = (I64)(atof(argv[i]) * 1048576.0);
+		if (ioinflight <= 0)
+		{
+			fprintf(stderr, "ERROR: '%s' is not a valid memory budget\n", argv[i]);
+			usage(true);
+		}
+	}
+	else if (strcmp(argv[i], "-max_memory") == 0)
+	{
+		if ((i + 1) >= argc)
+		{
+			fprintf(stderr, "ERROR: '%s' needs 1 argument: number of MB\n", argv[i]);
+			usage(true);
+		}
+		i++;
+		maxmemory = (I64)(atof(argv[i]) * 1048576.0);
+		if (maxmemory <= 0)
+		{
+			fprintf(stderr, "ERROR: '%s' is not a valid memory budget\n", argv[i]);
+			usage(true);
+		}
+	}
+	else if (strcmp(argv[i], "-laxdir") == 0)
+	{
+		if ((i + 1) >= argc)
+		{
+			fprintf(stderr, "ERROR: '%s' needs 1 argument: string\n", argv[i]);
+			usage(true);
+		}
+		i++;
+		laxdirname = argv[i];
+		argv[i][0] = '\0';
 	}
 	else if (strcmp(argv[i], "-fieldindexname") == 0)
 	{
@@ -296,322 +526,52 @@ int main(int argc, char *argv[])
     byebye(true, argc == 1);
   }
 
-  //////////////////////////////////////////
-  // possibly loop over multiple input files
-  //////////////////////////////////////////
-  while (lasreadopener.active())
+  //LAZ compression takes most of the writing time, the outputs are then
+  //compressed in parallel on as many I/O threads as hardware threads
+  if (strcmp(outputformat, "laz") == 0 && !iothreadsset)
   {
-    if (verbose) start_time = taketime();
+    U32 nhardware = std::thread::hardware_concurrency();
+    if (nhardware > iothreads) iothreads = nhardware;
+  }
 
-	/////////////////
-    // open lasreader
-	/////////////////
-    LASreader* lasreader = lasreadopener.open();
-    if (lasreader == 0)
+  if (!laxdirname.empty() && !direxists(laxdirname.c_str()))
+  {
+    if (_mkdir(laxdirname.c_str()) == -1)
     {
-      fprintf(stderr, "ERROR: could not open lasreader\n");
-      byebye(true, argc==1);
+      fprintf(stderr, "WARNING: can't create LAX dir, not caching LAX files\n");
+      laxdirname.clear();
     }
+  }
 
-	///////////////////////////////////
-    // (maybe) open laswaveform13reader
-	///////////////////////////////////
-    LASwaveform13reader* laswaveform13reader = lasreadopener.open_waveform13(&lasreader->header);
-
-	//////////////////////////////
-    // get a pointer to the header
-	//////////////////////////////
-
-    LASheader* header = &(lasreader->header);
-
-	///////////////////////////////
-	//open shapefile using GDAL/OGR
-	///////////////////////////////
-	GDALAllRegister();
-
-	GDALDataset* poDS;
-	poDS = (GDALDataset*)GDALOpenEx(shapefilename.c_str(), GDAL_OF_VECTOR, NULL, NULL, NULL);
-	if (poDS == NULL)
-	{
-		fprintf(stderr, "Error: Open shapefile failed.\n");
-		byebye(true, argc == 1);
-	}
-
-	OGRLayer* poLayer;
-	//poLayer = poDS->GetLayerByName("slice-1");
-	//poLayer = poDS->GetLayerByName("300_5094_petawawa_allhits_cgvd28_CHM_crowns(clipped)");
-	//poLayer = poDS->GetLayerByName("300_5094_petawawa_allhits_cgvd28_CHM_crowns");
-	poLayer = poDS->GetLayerByName(shapefilelayername.c_str());
-	
-	if (poLayer==NULL)
-	{
-		fprintf(stderr, "Error: Get shapefile layer by name failed.\n");
-		GDALClose(poDS);
-		byebye(true, argc == 1);
-	}
-
-	I64 numberoffeatures = poLayer->GetFeatureCount();
-
-
-
-#ifdef _WIN32
-	if (verbose) fprintf(stderr, "processing %I64d points against %I64d features.\n", lasreader->npoints, numberoffeatures);
-#else
-	if (verbose) fprintf(stderr, "processing %lld points against %lld features.\n", lasreader->npoints, numberoffeatures);
-#endif
-
-
-	///////////////////////////////////////////////
-	//create output folder name for micro las files
-	///////////////////////////////////////////////
-	if (!direxists(outputdirname.c_str()))
-	{
-		if (_mkdir(outputdirname.c_str()) == -1)
-		{
-			fprintf(stderr, "ERROR: can't create output dir\n");
-			byebye(true, argc == 1);
-		}
-	}
-
-	// prepare the header for the surviving points
-	strncpy(lasreader->header.system_identifier, "LASapps", 32);
-	lasreader->header.system_identifier[31] = '\0';
-	char temp[64];
-	//sprintf(temp, "lasclip (version %d)", LAS_TOOLS_VERSION);
-	sprintf(temp, "lasclip (version 0.1)");
-	strncpy(lasreader->header.generating_software, temp, 32);
-	lasreader->header.generating_software[31] = '\0';
-
-	OGRPoint myOGRPoint;
-	OGRSpatialReference mySRS;
-	//mySRS.SetWellKnownGeogCS("EPSG:26918");
-	//mySRS.SetWellKnownGeogCS("EPSG:2959");
-	//myOGRPoint.assignSpatialReference(&mySRS);
-	LASpoint* pLASpoint = new LASpoint;
-	// if the point needs to be copied set up the data fields
-	pLASpoint->init(&lasreader->header, lasreader->header.point_data_format, lasreader->header.point_data_record_length);
-
-	//////////////////////////////////////////
-	//load all LAS input file points in memory
-	//////////////////////////////////////////
-	if (dynamic_cast <LASreaderLASRAM*>(lasreader)) 
-	{
-		if ((dynamic_cast <LASreaderLASRAM*>(lasreader))->read_allpoints()==FALSE)
-		{
-			fprintf(stderr, "ERROR: LASreaderLASRAM read_allpoints() failed, not enough memory.\n");
-			byebye(true, argc == 1);
-		}
-	}
-	/////////////////////////////
-	//browse through each polygon
-	/////////////////////////////
-	OGRFeature *poFeature;
-	poLayer->ResetReading();
-	//while (lasreader->read_point() && ((poFeature = poLayer->GetNextFeature()) != NULL))
-	I64 ii = 0;
-	while ( (poFeature = poLayer->GetNextFeature()) != NULL)
-	{
-		OGRGeometry *poGeometry;
-		poGeometry = poFeature->GetGeometryRef();
-
-		if (poGeometry != NULL
-			&& (wkbFlatten(poGeometry->getGeometryType()) == wkbPolygon))
-		{
-			OGREnvelope myOGREnvelope;
-			poGeometry->getEnvelope(&myOGREnvelope);
-			//OGRPolygon* poPolygon = (OGRPolygon*)poGeometry;
-			if (verbose && false) fprintf(stderr, "found polygon\n");
-
-			bool isnumericcrownid = true;
-			I64 crownid = ii;
-			std::string crownidstring = "";
-
-			OGRFeatureDefn* poFDefn = poLayer->GetLayerDefn();
-			if (poFDefn==NULL)
-			{
-				fprintf(stderr, "ERROR: calling OGR GetLayerDefn().\n");
-				byebye(true, argc == 1);
-			}
-			//int iField = poFDefn->GetFieldIndex("Object_ID");
-			int iField = poFDefn->GetFieldIndex(fieldindexname.c_str());
-			if (iField==-1)
-			{
-				fprintf(stderr, "WARNING: fieldindexname not found\n");
-				fprintf(stderr, "WARNING: will name microlas files using default index\n");
-
-				//byebye(true, argc == 1);
-			}
-			else
-			{
-				//improved to suit simon's need as well as rachel's need
-				OGRFieldDefn *poFieldDefn = poFDefn->GetFieldDefn(iField);
-				if (poFieldDefn->GetType() == OFTInteger)
-				{
-					crownid = poFeature->GetFieldAsInteger(iField);
-				}
-				else if (poFieldDefn->GetType() == OFTInteger64)
-				{
-					crownid = poFeature->GetFieldAsInteger64(iField);
-				}
-				else if (poFieldDefn->GetType() == OFTString)
-				{
-					crownidstring = poFeature->GetFieldAsString(iField);
-					isnumericcrownid = false;
-				}
-				else
-				{
-					fprintf(stderr, "WARNING: fieldindexname not of type OFTInteger, OFTInteger64 nor OFTString\n");
-					fprintf(stderr, "WARNING: will name microlas files using default index\n");
-
-					//byebye(true, argc == 1);
-				}
-			}
-			
-			if (verbose && false) fprintf(stderr, "%I64d features remaining\n", numberoffeatures-ii);
-
-			if (!laswriteopener.active())
-			{
-				// create name from input name
-				char pchar[64];
-				sprintf(pchar, "%I64d", crownid);
-				std::string microlasfilename;
-				if (isnumericcrownid)
-				{
-					//microlasfilename = lasfilenamewithoutextension + "\\" + pchar + ".las";
-					microlasfilename = outputdirname + "\\" + getfilenameonly(lasreadopener.get_file_name_only()) + "_" + pchar + ".las";
-				}
-				else
-				{
-					//microlasfilename = lasfilenamewithoutextension + "\\" + crownidstring + ".las";
-					microlasfilename = outputdirname + "\\" + getfilenameonly(lasreadopener.get_file_name_only()) + "_" + crownidstring + ".las";
-				}
-				laswriteopener.set_file_name(microlasfilename.c_str());
-			}
-			else
-			{
-				fprintf(stderr, "ERROR: laswriteopener is active.\n");
-				byebye(true, argc == 1);
-			}
-
-			/////////////////
-			// open laswriter
-			/////////////////
-			LASwriter* laswriter = laswriteopener.open(&lasreader->header);
-
-			if (laswriter == 0)
-			{
-				fprintf(stderr, "ERROR: could not open laswriter\n");
-				byebye(true, argc == 1);
-			}
-
-			/*
-			OGRPoint myOGRPoint;
-			OGRSpatialReference mySRS;
-			//mySRS.SetWellKnownGeogCS("EPSG:26918");
-			//mySRS.SetWellKnownGeogCS("EPSG:2959");
-			//myOGRPoint.assignSpatialReference(&mySRS);
-			LASpoint* pLASpoint = new LASpoint;
-			// if the point needs to be copied set up the data fields
-			pLASpoint->init(&lasreader->header, lasreader->header.point_data_format, lasreader->header.point_data_record_length);
-			*/
-
-			lasreader->seek(0);
-			lasreader->inside_none();
-			lasreader->inside_rectangle(myOGREnvelope.MinX, myOGREnvelope.MinY, myOGREnvelope.MaxX, myOGREnvelope.MaxY);
-			if (dynamic_cast <LASreaderLASRAM*>(lasreader))
-			{
-				LASreaderLASRAM* lasreaderlasram = dynamic_cast <LASreaderLASRAM*>(lasreader);
-				while (lasreaderlasram->read_point())
-				{
-					myOGRPoint.setX(lasreaderlasram->ppoint->get_x());
-					myOGRPoint.setY(lasreaderlasram->ppoint->get_y());
-
-					if (myOGRPoint.Within(poGeometry))
-					{
-						//fprintf(stdout, "keeping point\n");
-						/* //try to avoid copying ppoint again
-						*pLASpoint = *(lasreaderlasram->ppoint);
-						laswriter->write_point(pLASpoint);
-						laswriter->update_inventory(pLASpoint);
-						*/
-						laswriter->write_point(lasreaderlasram->ppoint);
-						laswriter->update_inventory(lasreaderlasram->ppoint);
-					}
-				}
-			}
-			else
-			{
-				while (lasreader->read_point())
-				{
-					myOGRPoint.setX(lasreader->point.get_x());
-					myOGRPoint.setY(lasreader->point.get_y());
-
-					if (myOGRPoint.Within(poGeometry))
-					{
-						//fprintf(stdout, "keeping point\n");
-						*pLASpoint = lasreader->point;
-						laswriter->write_point(pLASpoint);
-						laswriter->update_inventory(pLASpoint);
-					}
-				}
-			}
-
-			/*
-			delete pLASpoint;
-			*/
-			laswriter->update_header(&lasreader->header, TRUE);
-			laswriter->close();
-			delete laswriter;
-
-			laswriteopener.set_file_name(0);
-
-			//fprintf(stdout, "%f,%f,%f\n", poPoint->getX() - lasreader->point.get_x(), poPoint->getY() - lasreader->point.get_y(), poPoint->getZ() - lasreader->point.get_z());
-			//fprintf(stdout, "%f,%f,%f\n", lasreader->point.get_x(), lasreader->point.get_y(), lasreader->point.get_z());
-			if (verbose)
-				term_progress(std::cout, (ii + 1) / static_cast<double>(numberoffeatures));
-
-			ii++; //valid polygon counter
-		}
-		else
-		{
-			fprintf(stderr, "WARNING: not a polygon geometry, ignoring this geometry\n");
-		}
-
-		OGRFeature::DestroyFeature(poFeature);
-
-	}
-
-	delete pLASpoint;
-
-	//lasreader->inside_none();
-#ifdef _WIN32
-	//if (verbose) fprintf(stderr, "clipping %I64d points of '%s' against %I64d polygons took %g sec.\n", lasreader->p_count, lasreadopener.get_file_name(), ii, taketime() - start_time);
-	if (verbose) fprintf(stderr,"clipping %I64d points of '%s' against %I64d polygons took %g sec.\n", lasreader->npoints, lasreadopener.get_file_name(), ii, taketime()-start_time);
-#else
-    if (verbose) fprintf(stderr,"comparing %lld points of '%s' against %lld polygons took %g sec.\n", lasreader->npoints, lasreadopener.get_file_name(), ii, taketime()-start_time);
-#endif
-
-    // close the reader
-    lasreader->close();
-    delete lasreader;
+  LASclipEngine lasclipengine;
+  lasclipengine.set_verbose(verbose);
+  lasclipengine.set_single_pass(singlepass);
+  lasclipengine.set_ram_index(ramindex);
+  lasclipengine.set_build_lax(buildlax);
+  lasclipengine.set_write_lax(writelax);
+  lasclipengine.set_lax_directory(laxdirname.c_str());
+  lasclipengine.set_map_points(mappoints);
+  lasclipengine.set_container(container);
+  lasclipengine.set_exact_size(exactsize);
+  lasclipengine.set_max_memory(maxmemory);
+  lasclipengine.set_threads(nthreads);
+  lasclipengine.set_io_threads(iothreads);
+  lasclipengine.set_io_buffer(iobuffer);
+  lasclipengine.set_io_max_memory(ioinflight);
+  lasclipengine.set_format(outputformat);
+  lasclipengine.set_field_index_name(fieldindexname.c_str());
 
-    // (maybe) close the waveform reader
-    if (laswaveform13reader)
+  //////////////////////////////////////////
+  // possibly loop over multiple input files
+  //////////////////////////////////////////
+  for (U32 f = 0; f < lasreadopener.get_file_name_number(); f++)
+  {
+    if (!lasclipengine.clip(lasreadopener.get_file_name(f), shapefilename.c_str(), outputdirname.c_str()))
     {
-      laswaveform13reader->close();
-      delete laswaveform13reader;
+      byebye(true, argc == 1);
     }
-
-	/*
-    // close the files
-
-    if (file_out != stdout) fclose(file_out);
-	*/
-	GDALClose(poDS);
-
   }
 
-
   byebye(false, argc==1);
 
   return 0;
@@ -0,0 +1,1310 @@
+/*
+===============================================================================
+
+FILE:  lasclipengine.cpp
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- -buildlax only skipped when the header sends the points out-of-core
+17 October 2026 -- points written in the order of the file with the RAM cell index too
+17 October 2026 -- points loaded by the -threads of the engine, one thread by default
+17 October 2026 -- -max_memory of -singlepass counts the buffers of the outputs, deferred past 256
+17 October 2026 -- one scratch directory per clip, for the spill files of -exact_size too
+17 October 2026 -- builds on Linux too, for lasbatchclip
+17 October 2026 -- header template of -exact_size made in a scratch directory
+17 October 2026 -- out-of-core buckets opened by batches, in a scratch directory
+17 October 2026 -- no LAX built in-process when clipping out-of-core
+17 October 2026 -- LAX built in-process only when asked for with set_build_lax()
+17 October 2026 -- buckets of the single pass pipeline kept under -max_memory
+17 October 2026 -- single pass pipeline writes the outputs during the pass, bounding its buckets
+17 October 2026 -- clip() against a layer of the caller, for the spatial join of lasbatchclip
+17 October 2026 -- created from lasclip to run it in-process in lasbatchclip
+
+===============================================================================
+*/
+
+#include "lasclipengine.h"
+#include "laswaveform13reader.hpp"
+#include "lasreadopenerram.h"
+#include "lasreaderlasram.h"
+#include "laspolygonindex.h"
+#include "lastaskscheduler.h"
+#include "lasboundedqueue.h"
+
+#include "ogrsf_frmts.h"
+
+#ifdef _WIN32
+#include <windows.h> //for direxists()
+#include <direct.h> //for _mkdir() and _rmdir()
+#include <process.h> //for _getpid()
+#else
+#include <sys/stat.h> //for mkdir()
+#include <unistd.h> //for rmdir() and getpid()
+#define _mkdir(dirname) mkdir(dirname, 0777)
+#define _rmdir rmdir
+#define _getpid getpid
+#endif
+#include "lasappsutility.h"
+#include <iostream> //for term_progress()
+#include <algorithm> //for sort()
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+//number of candidate points gathered before a block point-in-polygon test
+#define LASCLIP_BLOCK_SIZE 1024
+//number of points read per block by the first stage of the single pass pipeline
+#define LASCLIP_PIPELINE_BLOCK_SIZE 65536
+//outputs of the single pass pipeline that get their file during the pass,
+//well below the 512 files a process opens by default on Windows, the others
+//are deferred
+#define LASCLIP_PIPELINE_MAX_OPEN_OUTPUTS 256
+//bucket files of the out-of-core clipping open at once, more groups take
+//more passes over the points
+#define LASCLIP_MAX_OPEN_BUCKETS 256
+
+//bytes needed to clip points loaded in RAM, their records unless mapped,
+//their X, Y and Z columns and where the cell index moved each point from
+static I64 getneededmemory(I64 npoints, U32 point_size, bool mapped, bool cellindex)
+{
+	return npoints * ((mapped ? 0 : point_size) + 12 + (cellindex ? 4 : 0));
+}
+
+//creates the directory of the temporary files of a clip(). it is named after
+//the LAS file with a '.' so that it is never taken for an output, and made
+//unique so that jobs clipping the same LAS file at once do not share it.
+//returns "" on error.
+static std::string makescratchdirectory(const std::string& outputdirname, const std::string& lasfilenameonly)
+{
+	static std::atomic<U32> nscratch(0);
+	char scratchnumber[64];
+	sprintf(scratchnumber, ".lasclip%d_%u", (int)_getpid(), nscratch.fetch_add(1));
+	std::string scratchdirname = outputdirname + LAS_PATH_SEPARATOR + lasfilenameonly + scratchnumber;
+	if (_mkdir(scratchdirname.c_str()) == -1)
+	{
+		fprintf(stderr, "ERROR: cannot create scratch directory '%s'\n", scratchdirname.c_str());
+		return "";
+	}
+	return scratchdirname;
+}
+
+//creates the output LAS file name of a polygon feature, tagged with the
+//fieldindexname attribute when found, with the polygon index ii otherwise
+static std::string getmicrolasfilename(OGRLayer* poLayer, OGRFeature* poFeature, I64 ii, const std::string& fieldindexname, const std::string& outputdirname, const std::string& lasfilenameonly)
+{
+	bool isnumericcrownid = true;
+	I64 crownid = ii;
+	std::string crownidstring = "";
+
+	OGRFeatureDefn* poFDefn = poLayer->GetLayerDefn();
+	if (poFDefn==NULL)
+	{
+		fprintf(stderr, "ERROR: calling OGR GetLayerDefn().\n");
+		return "";
+	}
+	//int iField = poFDefn->GetFieldIndex("Object_ID");
+	int iField = poFDefn->GetFieldIndex(fieldindexname.c_str());
+	if (iField==-1)
+	{
+		fprintf(stderr, "WARNING: fieldindexname not found\n");
+		fprintf(stderr, "WARNING: will name microlas files using default index\n");
+
+		//byebye(true, wait);
+	}
+	else
+	{
+		//improved to suit simon's need as well as rachel's need
+		OGRFieldDefn *poFieldDefn = poFDefn->GetFieldDefn(iField);
+		if (poFieldDefn->GetType() == OFTInteger)
+		{
+			crownid = poFeature->GetFieldAsInteger(iField);
+		}
+		else if (poFieldDefn->GetType() == OFTInteger64)
+		{
+			crownid = poFeature->GetFieldAsInteger64(iField);
+		}
+		else if (poFieldDefn->GetType() == OFTString)
+		{
+			crownidstring = poFeature->GetFieldAsString(iField);
+			isnumericcrownid = false;
+		}
+		else
+		{
+			fprintf(stderr, "WARNING: fieldindexname not of type OFTInteger, OFTInteger64 nor OFTString\n");
+			fprintf(stderr, "WARNING: will name microlas files using default index\n");
+
+			//byebye(true, wait);
+		}
+	}
+
+	char pchar[64];
+#ifdef _WIN32
+	sprintf(pchar, "%I64d", crownid);
+#else
+	sprintf(pchar, "%lld", crownid);
+#endif
+	std::string microlasfilename;
+	if (isnumericcrownid)
+	{
+		//microlasfilename = lasfilenamewithoutextension + "\\" + pchar + ".las";
+		microlasfilename = outputdirname + LAS_PATH_SEPARATOR + lasfilenameonly + "_" + pchar + ".las";
+	}
+	else
+	{
+		//microlasfilename = lasfilenamewithoutextension + "\\" + crownidstring + ".las";
+		microlasfilename = outputdirname + LAS_PATH_SEPARATOR + lasfilenameonly + "_" + crownidstring + ".las";
+	}
+	return microlasfilename;
+}
+
+//collects the polygons of the layer, set up in the quantized space of the
+//points, along with the name of their output file. returns FALSE when the
+//layer cannot be read.
+static BOOL collectpolygons(LASreader* lasreader, OGRLayer* poLayer, vector<LASpolygon>& polygonvector, vector<std::string>& microlasfilenamevector, const std::string& fieldindexname, const std::string& outputdirname, const std::string& lasfilenameonly)
+{
+	if (poLayer->GetLayerDefn() == NULL)
+	{
+		fprintf(stderr, "ERROR: calling OGR GetLayerDefn().\n");
+		return FALSE;
+	}
+	I64 ii = 0;
+	OGRFeature *poFeature;
+	poLayer->ResetReading();
+	while ((poFeature = poLayer->GetNextFeature()) != NULL)
+	{
+		OGRGeometry *poGeometry = poFeature->GetGeometryRef();
+		if (poGeometry != NULL
+			&& (wkbFlatten(poGeometry->getGeometryType()) == wkbPolygon || wkbFlatten(poGeometry->getGeometryType()) == wkbMultiPolygon))
+		{
+			polygonvector.push_back(LASpolygon());
+			LASpolygon& polygon = polygonvector.back();
+			polygon.setup(poGeometry, &lasreader->header);
+			microlasfilenamevector.push_back(getmicrolasfilename(poLayer, poFeature, ii, fieldindexname, outputdirname, lasfilenameonly));
+			ii++; //valid polygon counter
+		}
+		else
+		{
+			fprintf(stderr, "WARNING: not a polygon geometry, ignoring this geometry\n");
+		}
+		OGRFeature::DestroyFeature(poFeature);
+	}
+	return TRUE;
+}
+
+//block of points moving through the stages of the single pass pipeline
+struct LASclipBlock
+{
+	//blocks are numbered in the order they are read
+	U64 sequence;
+	//points in RAM are referenced through their columns, streamed points are
+	//copied into the block
+	I64 first;
+	U32 npoints;
+	const I32* X;
+	const I32* Y;
+	vector<I32> streamX;
+	vector<I32> streamY;
+	vector<U8> records;
+	//points inside a polygon, as pairs of polygon and point of the block
+	vector<U32> hitpolygons;
+	vector<U32> hitpoints;
+};
+
+//second stage of the pipeline, several classifiers route the points of the
+//blocks to the polygons containing them. a null block ends the stage.
+static void clipclassifier(const vector<LASpolygon>* polygonvector, const LASpolygonIndex* polygonindex, LASboundedQueue<LASclipBlock*>* readqueue, LASboundedQueue<LASclipBlock*>* classifiedqueue)
+{
+	LASclipBlock* block;
+	const U32* candidates;
+	U32 c, ncandidates;
+	while (true)
+	{
+		readqueue->pop(&block);
+		if (block == 0) break;
+		block->hitpolygons.clear();
+		block->hitpoints.clear();
+		for (U32 k = 0; k < block->npoints; k++)
+		{
+			//polygons and their index are in the quantized space of the points
+			I32 X = block->X[k];
+			I32 Y = block->Y[k];
+			ncandidates = polygonindex->get_candidates((F64)X, (F64)Y, &candidates);
+			for (c = 0; c < ncandidates; c++)
+			{
+				if ((*polygonvector)[candidates[c]].inside(X, Y))
+				{
+					block->hitpolygons.push_back(candidates[c]);
+					block->hitpoints.push_back(k);
+				}
+			}
+		}
+		classifiedqueue->push(block);
+	}
+	classifiedqueue->push(0);
+}
+
+//third stage of the pipeline, puts the classified blocks back in the order
+//they were read, so that outputs do not depend on the number of
+//classifiers, and hands them on to the writer. it ends once every
+//classifier has ended.
+static void clipbucketer(LASboundedQueue<LASclipBlock*>* classifiedqueue, LASboundedQueue<LASclipBlock*>* orderedqueue, U32 nblocks, U32 nclassifiers)
+{
+	//at most nblocks consecutive blocks are in flight
+	vector<LASclipBlock*> pending(nblocks, (LASclipBlock*)0);
+	U64 next = 0;
+	U32 nended = 0;
+	LASclipBlock* block;
+	while (nended < nclassifiers)
+	{
+		classifiedqueue->pop(&block);
+		if (block == 0)
+		{
+			nended++;
+			continue;
+		}
+		pending[block->sequence % nblocks] = block;
+		while ((block = pending[next % nblocks]) != 0)
+		{
+			pending[next % nblocks] = 0;
+			orderedqueue->push(block);
+			next++;
+		}
+	}
+	orderedqueue->push(0);
+}
+
+//state of the writer, the last stage of the pipeline
+struct LASclipWriter
+{
+	LASreaderLASRAM* lasreaderlasram;
+	U32 point_size;
+	LASwriteBehind* writebehind;
+	const vector<std::string>* microlasfilenamevector;
+	const U32* polygonids;
+	//output of each polygon, once it has one, and the outputs with a file
+	vector<LASwriteBehindOutput*> outputvector;
+	U32 nopen;
+	//points of the polygons without output yet, point indices in RAM and
+	//point records otherwise
+	vector< vector<U32> > pointindexvector;
+	vector< vector<U8> > pointrecordvector;
+	//bytes of the buckets and of the buffers of the outputs, not handed over
+	//to writebehind yet, and the polygons that may hold some
+	I64 staged;
+	vector<U32> stagedpolygons;
+	vector<U8> isstaged;
+	//bytes staged over which they are all handed over, 0 for no limit
+	I64 max_staged;
+	BOOL warned;
+};
+
+//gives polygon p its output and moves its bucket on to it. past
+//LASCLIP_PIPELINE_MAX_OPEN_OUTPUTS outputs with a file, the output is
+//deferred, its full buffers spill to the scratch directory until it is closed
+static LASwriteBehindOutput* clipwriteropen(LASclipWriter* writer, U32 p)
+{
+	LASwriteBehind* writebehind = writer->writebehind;
+	BOOL deferred = (writer->nopen >= LASCLIP_PIPELINE_MAX_OPEN_OUTPUTS);
+	LASwriteBehindOutput* output = writebehind->open((*writer->microlasfilenamevector)[p].c_str(), (writer->polygonids ? writer->polygonids[p] : p), deferred);
+	writer->outputvector[p] = output;
+	if (!deferred) writer->nopen++;
+	if (writer->lasreaderlasram)
+	{
+		vector<U32>& indices = writer->pointindexvector[p];
+		for (size_t i = 0; i < indices.size(); i++) writebehind->write_record(output, writer->lasreaderlasram->get_record(indices[i]));
+		writer->staged -= indices.size() * sizeof(U32);
+		vector<U32>().swap(indices);
+	}
+	else
+	{
+		vector<U8>& records = writer->pointrecordvector[p];
+		if (records.size()) writebehind->write_records(output, &records[0], records.size() / writer->point_size);
+		writer->staged -= records.size();
+		vector<U8>().swap(records);
+	}
+	//the records left over from the full buffers
+	writer->staged += (I64)writebehind->get_buffered_size(output);
+	return output;
+}
+
+//hands the buckets and the buffers of all staged polygons over to
+//writebehind, the buckets through their outputs
+static void clipwriterhandover(LASclipWriter* writer)
+{
+	if (!writer->warned)
+	{
+		fprintf(stderr, "WARNING: buckets exceed -max_memory, handing them over before they fill a buffer\n");
+		writer->warned = TRUE;
+	}
+	LASwriteBehind* writebehind = writer->writebehind;
+	vector<U32> stagedpolygons;
+	stagedpolygons.swap(writer->stagedpolygons);
+	for (size_t s = 0; s < stagedpolygons.size(); s++)
+	{
+		U32 p = stagedpolygons[s];
+		LASwriteBehindOutput* output = writer->outputvector[p];
+		if (output == 0) output = clipwriteropen(writer, p);
+		writer->staged -= (I64)writebehind->get_buffered_size(output);
+		writebehind->hand_over(output);
+		//kept by outputs that cannot be handed over before they are closed
+		size_t left = writebehind->get_buffered_size(output);
+		writer->staged += (I64)left;
+		if (left) writer->stagedpolygons.push_back(p);
+		else writer->isstaged[p] = 0;
+	}
+	//what is left cannot go before the end of the pass, no use sweeping again
+	if (writer->staged > writer->max_staged) writer->max_staged = 0;
+}
+
+//last stage of the pipeline, writes the points of the ordered blocks to the
+//outputs of their polygons, then hands the blocks back to the reader. the
+//points of a polygon wait in its bucket until they fill a buffer of
+//writebehind, the polygon then gets its output and its full buffers go to
+//the I/O threads while the pass goes on. once the buckets and the partial
+//buffers of the outputs hold more than max_staged bytes, they are all
+//handed over. a null block ends the stage.
+static void clipwriter(LASboundedQueue<LASclipBlock*>* orderedqueue, LASboundedQueue<LASclipBlock*>* freequeue, LASclipWriter* writer)
+{
+	LASwriteBehind* writebehind = writer->writebehind;
+	size_t buffer_size = writebehind->get_buffer_size();
+	U32 point_size = writer->point_size;
+	LASclipBlock* block;
+	while (true)
+	{
+		orderedqueue->pop(&block);
+		if (block == 0) break;
+		for (size_t h = 0; h < block->hitpoints.size(); h++)
+		{
+			U32 p = block->hitpolygons[h];
+			U32 k = block->hitpoints[h];
+			const U8* record = (writer->lasreaderlasram ? writer->lasreaderlasram->get_record(block->first + k) : &block->records[(size_t)k * point_size]);
+			LASwriteBehindOutput* output = writer->outputvector[p];
+			if (output)
+			{
+				//a full buffer is handed over, leaving an empty one
+				I64 buffered = (I64)writebehind->get_buffered_size(output);
+				writebehind->write_record(output, record);
+				writer->staged += (I64)writebehind->get_buffered_size(output) - buffered;
+			}
+			else
+			{
+				size_t nbytes;
+				if (writer->lasreaderlasram)
+				{
+					vector<U32>& indices = writer->pointindexvector[p];
+					indices.push_back((U32)(block->first + k));
+					nbytes = indices.size() * point_size;
+					writer->staged += sizeof(U32);
+				}
+				else
+				{
+					vector<U8>& records = writer->pointrecordvector[p];
+					records.insert(records.end(), record, record + point_size);
+					nbytes = records.size();
+					writer->staged += point_size;
+				}
+				//the bucket fills a buffer, it goes on to its output
+				if (nbytes >= buffer_size) clipwriteropen(writer, p);
+			}
+			if (!writer->isstaged[p])
+			{
+				writer->isstaged[p] = 1;
+				writer->stagedpolygons.push_back(p);
+			}
+			if (writer->max_staged > 0 && writer->staged > writer->max_staged) clipwriterhandover(writer);
+		}
+		freequeue->push(block);
+	}
+}
+
+//clips the given polygons reading the points of lasreader only once. polygon
+//envelopes are gridded by a LASpolygonIndex, each point is routed to the
+//polygons containing it and written to writebehind, one LAS file per
+//polygon. the polygons are numbered by polygonids when given, else by their
+//index. the points are read by blocks that a pipeline passes from the reader
+//to nthreads classifiers, to the bucketer and on to the writer, through
+//bounded queues, so that reading overlaps with point-in-polygon tests and
+//with writing. a fixed pool of blocks bounds the memory and holds the
+//reader back when the next stages fall behind. the points waiting in the
+//buckets are kept under maxmemory bytes when it is not 0.
+static void clippolygons(LASreader* lasreader, const vector<LASpolygon>& polygonvector, const vector<std::string>& microlasfilenamevector, const U32* polygonids, LASwriteBehind* writebehind, I64 maxmemory, U32 nthreads, bool verbose)
+{
+	U32 p;
+	LASpolygonIndex polygonindex;
+	for (p = 0; p < (U32)polygonvector.size(); p++)
+	{
+		const LASpolygon& polygon = polygonvector[p];
+		polygonindex.add(polygon.get_min_x(), polygon.get_min_y(), polygon.get_max_x(), polygon.get_max_y());
+	}
+	polygonindex.build();
+	U32 npolygons = polygonindex.get_number_of_polygons();
+
+	///////////////////////////////////////////////////////////////
+	//read the points once, routing each one to its polygon buckets
+	///////////////////////////////////////////////////////////////
+	LASreaderLASRAM* lasreaderlasram = dynamic_cast <LASreaderLASRAM*>(lasreader);
+	if (lasreaderlasram && !lasreaderlasram->is_loaded()) lasreaderlasram = 0;
+	U32 point_size = lasreader->point.total_point_size;
+	LASclipWriter writer;
+	writer.lasreaderlasram = lasreaderlasram;
+	writer.point_size = point_size;
+	writer.writebehind = writebehind;
+	writer.microlasfilenamevector = &microlasfilenamevector;
+	writer.polygonids = polygonids;
+	writer.outputvector.assign(npolygons, (LASwriteBehindOutput*)0);
+	writer.nopen = 0;
+	writer.staged = 0;
+	writer.isstaged.assign(npolygons, 0);
+	writer.max_staged = maxmemory;
+	writer.warned = FALSE;
+	//in RAM, a bucket lists point indices, otherwise it copies point records
+	writer.pointindexvector.resize(lasreaderlasram ? npolygons : 0);
+	writer.pointrecordvector.resize(lasreaderlasram ? 0 : npolygons);
+
+	U32 b, nclassifiers = (nthreads ? nthreads : 1);
+	U32 nblocks = 2 * nclassifiers + 2;
+	vector<LASclipBlock> blockvector(nblocks);
+	//the queues also hold the null blocks ending the classifiers
+	LASboundedQueue<LASclipBlock*> freequeue(nblocks);
+	LASboundedQueue<LASclipBlock*> readqueue(nblocks + nclassifiers);
+	LASboundedQueue<LASclipBlock*> classifiedqueue(nblocks + nclassifiers);
+	LASboundedQueue<LASclipBlock*> orderedqueue(nblocks + 1);
+	for (b = 0; b < nblocks; b++)
+	{
+		LASclipBlock* block = &blockvector[b];
+		if (!lasreaderlasram)
+		{
+			block->streamX.resize(LASCLIP_PIPELINE_BLOCK_SIZE);
+			block->streamY.resize(LASCLIP_PIPELINE_BLOCK_SIZE);
+			block->records.resize((size_t)LASCLIP_PIPELINE_BLOCK_SIZE * point_size);
+			block->X = &block->streamX[0];
+			block->Y = &block->streamY[0];
+		}
+		freequeue.push(block);
+	}
+	vector<std::thread> classifiers;
+	for (b = 0; b < nclassifiers; b++)
+	{
+		classifiers.push_back(std::thread(clipclassifier, &polygonvector, &polygonindex, &readqueue, &classifiedqueue));
+	}
+	std::thread bucketer(clipbucketer, &classifiedqueue, &orderedqueue, nblocks, nclassifiers);
+	std::thread writerthread(clipwriter, &orderedqueue, &freequeue, &writer);
+
+	//first stage, in RAM only the X and Y columns are read, records are left
+	//where they are
+	U64 sequence = 0;
+	I64 p_index = 0;
+	I64 npoints = (lasreaderlasram ? lasreaderlasram->get_ram_npoints() : 0);
+	if (!lasreaderlasram)
+	{
+		lasreader->seek(0);
+		lasreader->inside_none();
+	}
+	while (true)
+	{
+		LASclipBlock* block;
+		freequeue.pop(&block);
+		block->first = p_index;
+		block->npoints = 0;
+		if (lasreaderlasram)
+		{
+			I64 n = npoints - p_index;
+			block->npoints = (U32)(n < LASCLIP_PIPELINE_BLOCK_SIZE ? n : LASCLIP_PIPELINE_BLOCK_SIZE);
+			block->X = lasreaderlasram->get_X_array() + p_index;
+			block->Y = lasreaderlasram->get_Y_array() + p_index;
+		}
+		else
+		{
+			while (block->npoints < LASCLIP_PIPELINE_BLOCK_SIZE && lasreader->read_point())
+			{
+				block->streamX[block->npoints] = lasreader->point.X;
+				block->streamY[block->npoints] = lasreader->point.Y;
+				lasreader->point.copy_to(&block->records[(size_t)block->npoints * point_size]);
+				block->npoints++;
+			}
+		}
+		if (block->npoints == 0)
+		{
+			freequeue.push(block);
+			break;
+		}
+		p_index += block->npoints;
+		block->sequence = sequence++;
+		readqueue.push(block);
+		if (block->npoints < LASCLIP_PIPELINE_BLOCK_SIZE) break;
+	}
+	for (b = 0; b < nclassifiers; b++) readqueue.push(0);
+	for (b = 0; b < nclassifiers; b++) classifiers[b].join();
+	bucketer.join();
+	writerthread.join();
+
+	//////////////////////////////////////////////////////
+	//write the rest of each polygon bucket to its output
+	//////////////////////////////////////////////////////
+	for (p = 0; p < npolygons; p++)
+	{
+		LASwriteBehindOutput* output = writer.outputvector[p];
+		if (output == 0) output = writebehind->open(microlasfilenamevector[p].c_str(), (polygonids ? polygonids[p] : p));
+		if (lasreaderlasram)
+		{
+			vector<U32>& indices = writer.pointindexvector[p];
+			for (size_t k = 0; k < indices.size(); k++)
+			{
+				writebehind->write_record(output, lasreaderlasram->get_record(indices[k]));
+			}
+			vector<U32>().swap(indices);
+		}
+		else
+		{
+			vector<U8>& records = writer.pointrecordvector[p];
+			if (records.size()) writebehind->write_records(output, &records[0], records.size() / point_size);
+			vector<U8>().swap(records);
+		}
+		writebehind->close(output);
+
+		if (verbose)
+			term_progress(std::cout, (p + 1) / static_cast<double>(npolygons));
+	}
+}
+
+//clips all polygons of the layer reading the points only once. returns the
+//number of polygons clipped, -1 on error.
+static I64 clipsinglepass(LASreader* lasreader, OGRLayer* poLayer, LASwriteBehind* writebehind, const std::string& fieldindexname, const std::string& outputdirname, const std::string& lasfilenameonly, I64 maxmemory, U32 nthreads, bool verbose)
+{
+	vector<LASpolygon> polygonvector;
+	vector<std::string> microlasfilenamevector;
+	if (!collectpolygons(lasreader, poLayer, polygonvector, microlasfilenamevector, fieldindexname, outputdirname, lasfilenameonly)) return -1;
+	clippolygons(lasreader, polygonvector, microlasfilenamevector, 0, writebehind, maxmemory, nthreads, verbose);
+	return (I64)polygonvector.size();
+}
+
+//spreads the 16 low bits of v to the even bits of the result
+static U32 mortonspread(U32 v)
+{
+	v &= 0x0000FFFF;
+	v = (v | (v << 8)) & 0x00FF00FF;
+	v = (v | (v << 4)) & 0x0F0F0F0F;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+//clips all polygons of the layer within a memory budget. the polygons are
+//ordered along a Morton curve of their envelope centers and cut into groups
+//whose points are expected to fit in maxmemory bytes. a pass over the
+//points spills those of each group envelope into a LAS bucket file of the
+//scratch directory, up to LASCLIP_MAX_OPEN_BUCKETS groups per pass, each
+//bucket is then clipped in memory against its group of polygons and deleted.
+//returns the number of polygons clipped, -1 on error.
+static I64 clipoutofcore(LASreader* lasreader, OGRLayer* poLayer, LASwriteBehind* writebehind, const std::string& fieldindexname, const std::string& outputdirname, const std::string& scratchdirname, const std::string& lasfilenameonly, I64 maxmemory, U32 nthreads, bool verbose)
+{
+	U32 p, g;
+	vector<LASpolygon> polygonvector;
+	vector<std::string> microlasfilenamevector;
+	if (!collectpolygons(lasreader, poLayer, polygonvector, microlasfilenamevector, fieldindexname, outputdirname, lasfilenameonly)) return -1;
+	U32 npolygons = (U32)polygonvector.size();
+	if (npolygons == 0) return 0;
+
+	//////////////////////////////////////////////////////////////////
+	//order the polygons spatially, then group them by estimated points
+	//////////////////////////////////////////////////////////////////
+	LASheader* header = &lasreader->header;
+	F64 min_X = (header->min_x - header->x_offset) / header->x_scale_factor;
+	F64 min_Y = (header->min_y - header->y_offset) / header->y_scale_factor;
+	F64 size_X = (header->max_x - header->min_x) / header->x_scale_factor;
+	F64 size_Y = (header->max_y - header->min_y) / header->y_scale_factor;
+	F64 density = (size_X > 0.0 && size_Y > 0.0 ? lasreader->npoints / (size_X * size_Y) : (F64)lasreader->npoints);
+	vector< std::pair<U32, U32> > mortonvector(npolygons);
+	for (p = 0; p < npolygons; p++)
+	{
+		const LASpolygon& polygon = polygonvector[p];
+		F64 cx = (size_X > 0.0 ? ((polygon.get_min_x() + polygon.get_max_x()) / 2.0 - min_X) / size_X : 0.0);
+		F64 cy = (size_Y > 0.0 ? ((polygon.get_min_y() + polygon.get_max_y()) / 2.0 - min_Y) / size_Y : 0.0);
+		U32 col = (cx <= 0.0 ? 0 : (cx >= 1.0 ? 0xFFFF : (U32)(cx * 0xFFFF)));
+		U32 row = (cy <= 0.0 ? 0 : (cy >= 1.0 ? 0xFFFF : (U32)(cy * 0xFFFF)));
+		mortonvector[p] = std::make_pair(mortonspread(col) | (mortonspread(row) << 1), p);
+	}
+	std::sort(mortonvector.begin(), mortonvector.end());
+
+	//the points of a group are held twice at most, once read and once bucketed
+	U32 point_size = lasreader->point.total_point_size;
+	F64 grouppoints = (F64)maxmemory / (2.0 * (point_size + 16));
+	if (grouppoints < 1.0) grouppoints = 1.0;
+	vector< vector<U32> > groupvector;
+	F64 points = 0.0;
+	for (U32 m = 0; m < npolygons; m++)
+	{
+		p = mortonvector[m].second;
+		const LASpolygon& polygon = polygonvector[p];
+		F64 envelopepoints = 0.0;
+		if (polygon.get_min_x() <= polygon.get_max_x()) envelopepoints = (polygon.get_max_x() - polygon.get_min_x() + 1.0) * (polygon.get_max_y() - polygon.get_min_y() + 1.0) * density;
+		if (groupvector.empty() || (points + envelopepoints > grouppoints && !groupvector.back().empty()))
+		{
+			groupvector.push_back(vector<U32>());
+			points = 0.0;
+		}
+		groupvector.back().push_back(p);
+		points += envelopepoints;
+	}
+	U32 ngroups = (U32)groupvector.size();
+	if (verbose) fprintf(stderr, "clipping %u polygons in %u groups within %g MB of memory.\n", npolygons, ngroups, maxmemory / 1048576.0);
+
+	///////////////////////////////////////////////////////////////////
+	//spill the points of each group envelope into its bucket LAS file
+	///////////////////////////////////////////////////////////////////
+	LASpolygonIndex groupindex;
+	for (g = 0; g < ngroups; g++)
+	{
+		F64 gmin_x = 1.0, gmin_y = 1.0, gmax_x = 0.0, gmax_y = 0.0;
+		for (size_t k = 0; k < groupvector[g].size(); k++)
+		{
+			const LASpolygon& polygon = polygonvector[groupvector[g][k]];
+			if (polygon.get_min_x() > polygon.get_max_x()) continue;
+			if (gmin_x > gmax_x)
+			{
+				gmin_x = polygon.get_min_x(); gmin_y = polygon.get_min_y();
+				gmax_x = polygon.get_max_x(); gmax_y = polygon.get_max_y();
+				continue;
+			}
+			if (polygon.get_min_x() < gmin_x) gmin_x = polygon.get_min_x();
+			if (polygon.get_min_y() < gmin_y) gmin_y = polygon.get_min_y();
+			if (polygon.get_max_x() > gmax_x) gmax_x = polygon.get_max_x();
+			if (polygon.get_max_y() > gmax_y) gmax_y = polygon.get_max_y();
+		}
+		groupindex.add(gmin_x, gmin_y, gmax_x, gmax_y);
+	}
+	groupindex.build();
+
+	//////////////////////////////////////////////////////////////////////
+	//spill the points of a batch of group envelopes into their bucket LAS
+	//files, then clip each bucket against its group of polygons in memory
+	//////////////////////////////////////////////////////////////////////
+	if (scratchdirname.empty()) return -1;
+	vector<std::string> bucketfilenamevector(ngroups);
+	for (g = 0; g < ngroups; g++)
+	{
+		char bucketnumber[32];
+		sprintf(bucketnumber, "%u", g);
+		bucketfilenamevector[g] = scratchdirname + LAS_PATH_SEPARATOR + "bucket_" + bucketnumber + ".las";
+	}
+	vector<LASwriter*> bucketwritervector(ngroups < LASCLIP_MAX_OPEN_BUCKETS ? ngroups : LASCLIP_MAX_OPEN_BUCKETS);
+	LASwriteOpener bucketwriteopener;
+	bucketwriteopener.set_format("las");
+	I64 nclipped = npolygons;
+	for (U32 first = 0; first < ngroups && nclipped >= 0; first += LASCLIP_MAX_OPEN_BUCKETS)
+	{
+		U32 last = (ngroups - first > LASCLIP_MAX_OPEN_BUCKETS ? first + LASCLIP_MAX_OPEN_BUCKETS : ngroups);
+		for (g = first; g < last; g++)
+		{
+			bucketwriteopener.set_file_name(bucketfilenamevector[g].c_str());
+			bucketwritervector[g - first] = bucketwriteopener.open(header);
+			if (bucketwritervector[g - first] == 0) break;
+		}
+		if (g < last)
+		{
+			fprintf(stderr, "ERROR: could not open bucket laswriter\n");
+			while (g-- > first)
+			{
+				bucketwritervector[g - first]->close();
+				delete bucketwritervector[g - first];
+			}
+			nclipped = -1;
+			break;
+		}
+
+		const U32* candidates;
+		U32 c, ncandidates;
+		lasreader->seek(0);
+		lasreader->inside_none();
+		while (lasreader->read_point())
+		{
+			F64 X = (F64)lasreader->point.X;
+			F64 Y = (F64)lasreader->point.Y;
+			ncandidates = groupindex.get_candidates(X, Y, &candidates);
+			for (c = 0; c < ncandidates; c++)
+			{
+				g = candidates[c];
+				if (g >= first && g < last && groupindex.inside_envelope(g, X, Y))
+				{
+					bucketwritervector[g - first]->write_point(&lasreader->point);
+					bucketwritervector[g - first]->update_inventory(&lasreader->point);
+				}
+			}
+		}
+		for (g = first; g < last; g++)
+		{
+			bucketwritervector[g - first]->update_header(header, TRUE);
+			bucketwritervector[g - first]->close();
+			delete bucketwritervector[g - first];
+		}
+
+		for (g = first; g < last; g++)
+		{
+			LASreadOpener bucketreadopener;
+			bucketreadopener.set_file_name(bucketfilenamevector[g].c_str());
+			LASreader* bucketreader = bucketreadopener.open();
+			if (bucketreader == 0)
+			{
+				fprintf(stderr, "ERROR: could not open bucket lasreader\n");
+				nclipped = -1;
+				break;
+			}
+			vector<LASpolygon> grouppolygonvector;
+			vector<std::string> groupmicrolasfilenamevector;
+			for (size_t k = 0; k < groupvector[g].size(); k++)
+			{
+				grouppolygonvector.push_back(polygonvector[groupvector[g][k]]);
+				groupmicrolasfilenamevector.push_back(microlasfilenamevector[groupvector[g][k]]);
+			}
+			clippolygons(bucketreader, grouppolygonvector, groupmicrolasfilenamevector, &groupvector[g][0], writebehind, maxmemory, nthreads, false);
+			bucketreader->close();
+			delete bucketreader;
+			remove(bucketfilenamevector[g].c_str());
+			if (verbose)
+				term_progress(std::cout, (g + 1) / static_cast<double>(ngroups));
+		}
+	}
+	//the buckets left by an error
+	for (g = 0; g < ngroups; g++) remove(bucketfilenamevector[g].c_str());
+	return nclipped;
+}
+
+//writes the points accepted by a polygon, pairs of their index in the file
+//and in RAM, in the order of the file, which the cell index changed
+static void writeinfileorder(LASreaderLASRAM* lasreaderlasram, vector< std::pair<U32, U32> >& accepted, LASwriteBehind* writebehind, LASwriteBehindOutput* output)
+{
+	std::sort(accepted.begin(), accepted.end());
+	for (size_t a = 0; a < accepted.size(); a++) writebehind->write_record(output, lasreaderlasram->get_record(accepted[a].second));
+	accepted.clear();
+}
+
+//clips the polygons the scheduler hands to this worker, the points loaded in
+//RAM are only read, each worker owns its blocks and outputs
+static void clipworker(LASreaderLASRAM* lasreaderlasram, const vector<LASpolygon>* polygonvector, const vector<std::string>* microlasfilenamevector, LAStaskScheduler* scheduler, U32 worker, LASwriteBehind* writebehind, std::atomic<U32>* donepolygons)
+{
+	vector<I64> blockindices(LASCLIP_BLOCK_SIZE);
+	vector<F64> blockx(LASCLIP_BLOCK_SIZE);
+	vector<F64> blocky(LASCLIP_BLOCK_SIZE);
+	vector<U8> blockmask(LASCLIP_BLOCK_SIZE);
+	//outputs do not depend on the number of threads, so the points the cell
+	//index reordered are sorted back before they are written
+	BOOL reordered = lasreaderlasram->has_cell_index();
+	vector< std::pair<U32, U32> > accepted;
+
+	U32 p;
+	while (scheduler->next(worker, &p))
+	{
+		const LASpolygon& polygon = (*polygonvector)[p];
+		LASwriteBehindOutput* output = writebehind->open((*microlasfilenamevector)[p].c_str(), p);
+		//each worker runs its own query on the shared points
+		LASrectangleQuery query(lasreaderlasram, polygon.get_min_X(), polygon.get_min_Y(), polygon.get_max_X(), polygon.get_max_Y());
+		BOOL more = TRUE;
+		U32 nblock = 0;
+		while (more)
+		{
+			more = query.next(&blockindices[nblock]);
+			if (more)
+			{
+				blockx[nblock] = (F64)lasreaderlasram->get_X(blockindices[nblock]);
+				blocky[nblock] = (F64)lasreaderlasram->get_Y(blockindices[nblock]);
+				nblock++;
+			}
+			if (nblock == LASCLIP_BLOCK_SIZE || (!more && nblock))
+			{
+				polygon.inside(&blockx[0], &blocky[0], nblock, &blockmask[0]);
+				for (U32 b = 0; b < nblock; b++)
+				{
+					if (!blockmask[b]) continue;
+					if (reordered) accepted.push_back(std::make_pair((U32)lasreaderlasram->get_file_index(blockindices[b]), (U32)blockindices[b]));
+					else writebehind->write_record(output, lasreaderlasram->get_record(blockindices[b]));
+				}
+				nblock = 0;
+			}
+		}
+		if (reordered) writeinfileorder(lasreaderlasram, accepted, writebehind, output);
+		writebehind->close(output);
+		(*donepolygons)++;
+	}
+}
+
+//clips all polygons of the layer on nthreads threads sharing the points
+//loaded in RAM. returns the number of polygons clipped, -1 on error.
+static I64 clipthreads(LASreaderLASRAM* lasreaderlasram, OGRLayer* poLayer, LASwriteBehind* writebehind, const std::string& fieldindexname, const std::string& outputdirname, const std::string& lasfilenameonly, U32 nthreads, bool verbose)
+{
+	//OGR is not thread-safe, the polygons are all collected beforehand
+	vector<LASpolygon> polygonvector;
+	vector<std::string> microlasfilenamevector;
+	if (!collectpolygons(lasreaderlasram, poLayer, polygonvector, microlasfilenamevector, fieldindexname, outputdirname, lasfilenameonly)) return -1;
+	U32 npolygons = (U32)polygonvector.size();
+	if (nthreads > npolygons) nthreads = (npolygons ? npolygons : 1);
+	if (verbose) fprintf(stderr, "clipping %u polygons on %u threads.\n", npolygons, nthreads);
+
+	//the cost of a polygon is the number of points its query is expected to
+	//scan, from the cell index or the LAX when there is one, otherwise from
+	//its envelope area and the density of the header
+	vector<I64> costvector(npolygons);
+	for (U32 p = 0; p < npolygons; p++)
+	{
+		const LASpolygon& polygon = polygonvector[p];
+		costvector[p] = lasreaderlasram->estimate_points_inside(polygon.get_min_X(), polygon.get_min_Y(), polygon.get_max_X(), polygon.get_max_Y());
+	}
+	LAStaskScheduler scheduler;
+	scheduler.setup(costvector, nthreads);
+
+	std::atomic<U32> donepolygons(0);
+	vector<std::thread> workers;
+	for (U32 t = 0; t < nthreads; t++)
+	{
+		workers.push_back(std::thread(clipworker, lasreaderlasram, &polygonvector, &microlasfilenamevector, &scheduler, t, writebehind, &donepolygons));
+	}
+	if (verbose)
+	{
+		while (donepolygons < npolygons)
+		{
+			term_progress(std::cout, donepolygons / static_cast<double>(npolygons));
+			std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		}
+		term_progress(std::cout, 1.0);
+	}
+	for (U32 t = 0; t < nthreads; t++)
+	{
+		workers[t].join();
+	}
+	if (verbose) fprintf(stderr, "%u polygons stolen between threads.\n", scheduler.get_number_of_steals());
+	return npolygons;
+}
+
+
+LASclipEngine::LASclipEngine()
+{
+	verbose = FALSE;
+	single_pass = FALSE;
+	ram_index = FALSE;
+	build_lax = FALSE;
+	write_lax = FALSE;
+	map_points = FALSE;
+	container = FALSE;
+	exact_size = FALSE;
+	max_memory = 0;
+	nthreads = 1;
+	io_threads = 2;
+	io_buffer = 1048576;
+	io_max_memory = 256 * 1048576;
+	format = "las";
+	field_index_name = "Object_ID";
+	npolygons = 0;
+	npoints = 0;
+}
+
+LASclipEngine::~LASclipEngine()
+{
+}
+
+void LASclipEngine::init()
+{
+	static std::once_flag registered;
+	std::call_once(registered, GDALAllRegister);
+}
+
+BOOL LASclipEngine::clip(const CHAR* file_name, const CHAR* shapefile_name, const CHAR* output_directory)
+{
+	npolygons = 0;
+	npoints = 0;
+	init();
+
+	///////////////////////////////
+	//open shapefile using GDAL/OGR
+	///////////////////////////////
+	GDALDataset* poDS = (GDALDataset*)GDALOpenEx(shapefile_name, GDAL_OF_VECTOR, NULL, NULL, NULL);
+	if (poDS == NULL)
+	{
+		fprintf(stderr, "ERROR: could not open shapefile '%s'\n", shapefile_name);
+		return FALSE;
+	}
+	OGRLayer* poLayer = poDS->GetLayerByName(getfilenameonly(shapefile_name).c_str());
+	if (poLayer == NULL)
+	{
+		fprintf(stderr, "ERROR: could not get layer of shapefile '%s' by name\n", shapefile_name);
+		GDALClose(poDS);
+		return FALSE;
+	}
+	BOOL clipped = clip(file_name, poLayer, output_directory);
+	GDALClose(poDS);
+	return clipped;
+}
+
+BOOL LASclipEngine::clip(const CHAR* file_name, OGRLayer* poLayer, const CHAR* output_directory)
+{
+	double start_time = 0.0;
+	if (verbose) start_time = taketime();
+	npolygons = 0;
+	npoints = 0;
+	init();
+
+	/////////////////
+	// open lasreader
+	/////////////////
+#ifdef LASCLIP_RAM
+	LASreadOpenerRAM lasreadopener;
+	//a missing LAX is built in-process when asked for, since it reads the LAS
+	//file twice, unless the points are not queried by rectangle (-singlepass),
+	//are indexed once reordered in RAM (-ramindex, and -threads when no LAX
+	//exists) or are clipped out-of-core through bucket files, as the header
+	//tells from -max_memory before the index is opened
+	BOOL autoindex = (build_lax && !single_pass && !ram_index && nthreads <= 1);
+	if (autoindex && max_memory > 0)
+	{
+		LASreaderLAS lasreaderlas;
+		if (lasreaderlas.open(file_name, LAS_TOOLS_IO_IBUFFER_SIZE, TRUE))
+		{
+			autoindex = (getneededmemory(lasreaderlas.npoints, lasreaderlas.point.total_point_size, map_points == TRUE, false) <= max_memory);
+			lasreaderlas.close();
+		}
+	}
+	lasreadopener.set_auto_index(autoindex);
+	lasreadopener.set_write_index(write_lax);
+	if (!lax_directory.empty()) lasreadopener.set_index_directory(lax_directory.c_str());
+#else
+	LASreadOpener lasreadopener;
+#endif
+	lasreadopener.set_file_name(file_name);
+	LASreader* lasreader = lasreadopener.open();
+	if (lasreader == 0)
+	{
+		fprintf(stderr, "ERROR: could not open lasreader for '%s'\n", file_name);
+		return FALSE;
+	}
+	npoints = lasreader->npoints;
+
+	///////////////////////////////////
+	// (maybe) open laswaveform13reader
+	///////////////////////////////////
+	LASwaveform13reader* laswaveform13reader = lasreadopener.open_waveform13(&lasreader->header);
+
+	////////////////////////////////////////////////
+	//create output folder, possibly by another job
+	////////////////////////////////////////////////
+	std::string outputdirname = output_directory;
+	BOOL dirfailed = FALSE;
+	if (!direxists(outputdirname.c_str()))
+	{
+		if (_mkdir(outputdirname.c_str()) == -1 && !direxists(outputdirname.c_str()))
+		{
+			fprintf(stderr, "ERROR: can't create output dir '%s'\n", outputdirname.c_str());
+			dirfailed = TRUE;
+		}
+	}
+
+	I64 ii = -1;
+	if (!dirfailed)
+	{
+#ifdef _WIN32
+		if (verbose) fprintf(stderr, "processing %I64d points against %I64d features.\n", lasreader->npoints, poLayer->GetFeatureCount());
+#else
+		if (verbose) fprintf(stderr, "processing %lld points against %lld features.\n", lasreader->npoints, poLayer->GetFeatureCount());
+#endif
+		//for the spill files, the header template of -exact_size and the buckets
+		std::string scratchdirname = makescratchdirectory(outputdirname, getfilenameonly(file_name));
+		ii = clip_polygons(lasreader, poLayer, outputdirname, scratchdirname, getfilenameonly(file_name));
+		if (!scratchdirname.empty()) _rmdir(scratchdirname.c_str());
+	}
+
+	if (ii >= 0)
+	{
+		npolygons = ii;
+#ifdef _WIN32
+		if (verbose) fprintf(stderr, "clipping %I64d points of '%s' against %I64d polygons took %g sec.\n", lasreader->npoints, file_name, ii, taketime() - start_time);
+#else
+		if (verbose) fprintf(stderr, "clipping %lld points of '%s' against %lld polygons took %g sec.\n", lasreader->npoints, file_name, ii, taketime() - start_time);
+#endif
+	}
+
+	// close the reader
+	lasreader->close();
+	delete lasreader;
+
+	// (maybe) close the waveform reader
+	if (laswaveform13reader)
+	{
+		laswaveform13reader->close();
+		delete laswaveform13reader;
+	}
+
+	return (ii >= 0);
+}
+
+//clips the points of lasreader against the polygons of the layer, through the
+//write behind of the engine, with its temporary files in the scratch
+//directory, if any. returns the number of polygons, -1 on error.
+I64 LASclipEngine::clip_polygons(LASreader* lasreader, OGRLayer* poLayer, const std::string& outputdirname, const std::string& scratchdirname, const std::string& lasfilenameonly)
+{
+	// prepare the header for the surviving points
+	strncpy(lasreader->header.system_identifier, "LASapps", 32);
+	lasreader->header.system_identifier[31] = '\0';
+	char temp[64];
+	//sprintf(temp, "lasclip (version %d)", LAS_TOOLS_VERSION);
+	sprintf(temp, "lasclip (version 0.1)");
+	strncpy(lasreader->header.generating_software, temp, 32);
+	lasreader->header.generating_software[31] = '\0';
+
+	//outputs are created, filled and closed in the background
+	if (!writebehind.setup(&lasreader->header, format.c_str(), io_threads, io_buffer, io_max_memory))
+	{
+		fprintf(stderr, "ERROR: could not set up the LAS output files\n");
+		return -1;
+	}
+	writebehind.set_scratch_directory(scratchdirname.c_str());
+	if (container)
+	{
+		std::string containerfilename = outputdirname + LAS_PATH_SEPARATOR + lasfilenameonly + "_clipped";
+		writebehind.set_container((containerfilename + "." + format).c_str(), (containerfilename + ".csv").c_str());
+		if (verbose) fprintf(stderr, "writing all polygons to '%s.%s'.\n", containerfilename.c_str(), format.c_str());
+	}
+	if (exact_size)
+	{
+		if (container)
+		{
+			fprintf(stderr, "WARNING: -container has no file per polygon, ignoring -exact_size\n");
+		}
+		else if (scratchdirname.empty())
+		{
+			//outputs would wait in memory until closed
+			fprintf(stderr, "WARNING: -exact_size needs a scratch directory, ignoring it\n");
+		}
+		else if (!writebehind.set_exact_size((scratchdirname + LAS_PATH_SEPARATOR + "header.las").c_str()))
+		{
+			//not in the output directory, where it could be taken for an output
+			fprintf(stderr, "WARNING: -exact_size needs LAS outputs of point formats 0 to 5, ignoring it\n");
+		}
+	}
+
+	if (verbose) fprintf(stderr, "using %s point-in-polygon kernel.\n", LASpolygon::get_kernel_name());
+
+	//candidate points are tested by blocks, RAM points by reference to their
+	//records and streamed points by copy of their records
+	U32 nblock = 0;
+	U32 point_size = lasreader->point.total_point_size;
+	blockx.resize(LASCLIP_BLOCK_SIZE);
+	blocky.resize(LASCLIP_BLOCK_SIZE);
+	blockmask.resize(LASCLIP_BLOCK_SIZE);
+	blockrecordpointers.resize(LASCLIP_BLOCK_SIZE);
+	blockindices.resize(LASCLIP_BLOCK_SIZE);
+	blockrecords.resize(LASCLIP_BLOCK_SIZE * point_size);
+
+	/////////////////////////////////////////////////////////
+	//go out-of-core when the points exceed the memory budget
+	/////////////////////////////////////////////////////////
+	bool singlepass = (single_pass == TRUE);
+	bool outofcore = false;
+	if (max_memory > 0)
+	{
+		I64 neededmemory = 0;
+		//built after loading, with the points in RAM
+		BOOL cellindex = ((ram_index || (nthreads > 1 && !lasreader->get_index())) && !singlepass);
+		if (dynamic_cast <LASreaderLASRAM*>(lasreader)) neededmemory = getneededmemory(lasreader->npoints, point_size, map_points == TRUE, cellindex == TRUE);
+		else if (singlepass) neededmemory = lasreader->npoints * point_size;
+		outofcore = (neededmemory > max_memory);
+	}
+
+	//////////////////////////////////////////
+	//load all LAS input file points in memory
+	//////////////////////////////////////////
+	LASreaderLASRAM* lasreaderlasram = dynamic_cast <LASreaderLASRAM*>(lasreader);
+	if (outofcore)
+	{
+		if (ram_index) fprintf(stderr, "WARNING: points clipped out-of-core, ignoring -ramindex\n");
+	}
+	else if (lasreaderlasram)
+	{
+		BOOL mapped = FALSE;
+		if (map_points)
+		{
+			mapped = lasreaderlasram->map_allpoints();
+			if (!mapped) fprintf(stderr, "WARNING: cannot map points of '%s' in memory, loading them instead\n", lasfilenameonly.c_str());
+			else if (verbose) fprintf(stderr, "points of '%s' mapped in memory.\n", lasfilenameonly.c_str());
+		}
+		//never one thread per hardware thread, lasbatchclip runs -cores engines
+		lasreaderlasram->set_load_threads(nthreads);
+		if (!mapped && lasreaderlasram->read_allpoints() == FALSE)
+		{
+			fprintf(stderr, "ERROR: LASreaderLASRAM read_allpoints() failed, not enough memory.\n");
+			return -1;
+		}
+		//without LAX, the threads query the points through the cell index
+		if ((ram_index || (nthreads > 1 && !lasreader->get_index())) && !singlepass)
+		{
+			double index_start_time = taketime();
+			if (lasreaderlasram->build_cell_index() && verbose)
+			{
+				fprintf(stderr, "building RAM cell index took %g sec.\n", taketime() - index_start_time);
+			}
+		}
+	}
+	else if (ram_index)
+	{
+		fprintf(stderr, "WARNING: -ramindex needs the points in RAM, ignoring it\n");
+	}
+
+	/////////////////////////////
+	//browse through each polygon
+	/////////////////////////////
+	OGRFeature *poFeature;
+	poLayer->ResetReading();
+	I64 numberoffeatures = poLayer->GetFeatureCount();
+	I64 ii = 0;
+	if (singlepass && (lasreader->npoints > U32_MAX))
+	{
+		fprintf(stderr, "WARNING: too many points for -singlepass, clipping one polygon at a time\n");
+		singlepass = false;
+	}
+	bool threads = (nthreads > 1 && !outofcore && !singlepass && lasreaderlasram && lasreaderlasram->is_loaded());
+	if (nthreads > 1 && !threads && !singlepass && !outofcore) fprintf(stderr, "WARNING: -threads needs the points in RAM or -singlepass, using one thread\n");
+	if (threads)
+	{
+		ii = clipthreads(lasreaderlasram, poLayer, &writebehind, field_index_name, outputdirname, lasfilenameonly, nthreads, verbose == TRUE);
+	}
+	else if (outofcore)
+	{
+		ii = clipoutofcore(lasreader, poLayer, &writebehind, field_index_name, outputdirname, scratchdirname, lasfilenameonly, max_memory, nthreads, verbose == TRUE);
+	}
+	else if (singlepass)
+	{
+		ii = clipsinglepass(lasreader, poLayer, &writebehind, field_index_name, outputdirname, lasfilenameonly, max_memory, nthreads, verbose == TRUE);
+	}
+	while (!threads && !singlepass && !outofcore && (poFeature = poLayer->GetNextFeature()) != NULL)
+	{
+		OGRGeometry *poGeometry;
+		poGeometry = poFeature->GetGeometryRef();
+
+		if (poGeometry != NULL
+			&& (wkbFlatten(poGeometry->getGeometryType()) == wkbPolygon || wkbFlatten(poGeometry->getGeometryType()) == wkbMultiPolygon))
+		{
+			OGREnvelope myOGREnvelope;
+			poGeometry->getEnvelope(&myOGREnvelope);
+			//the polygon is tested against the raw X and Y of the points
+			polygon.setup(poGeometry, &lasreader->header);
+
+			/////////////////////////////////////////////
+			// open output, its file is written behind us
+			/////////////////////////////////////////////
+			std::string microlasfilename = getmicrolasfilename(poLayer, poFeature, ii, field_index_name, outputdirname, lasfilenameonly);
+			LASwriteBehindOutput* output = writebehind.open(microlasfilename.c_str(), (U32)ii);
+
+			lasreader->seek(0);
+			lasreader->inside_none();
+			lasreader->inside_rectangle(myOGREnvelope.MinX, myOGREnvelope.MinY, myOGREnvelope.MaxX, myOGREnvelope.MaxY);
+			if (lasreaderlasram)
+			{
+				//the rectangle filter scans the X and Y columns, records of the
+				//candidates are only decoded once accepted by the polygon
+				lasreaderlasram->set_decoding(FALSE);
+				BOOL reordered = lasreaderlasram->has_cell_index();
+				BOOL more = TRUE;
+				while (more)
+				{
+					more = lasreaderlasram->read_point();
+					if (more)
+					{
+						I64 p_index = lasreaderlasram->p_count - 1;
+						blockindices[nblock] = p_index;
+						blockrecordpointers[nblock] = lasreaderlasram->get_record(p_index);
+						blockx[nblock] = (F64)lasreaderlasram->get_X(p_index);
+						blocky[nblock] = (F64)lasreaderlasram->get_Y(p_index);
+						nblock++;
+					}
+					if (nblock == LASCLIP_BLOCK_SIZE || (!more && nblock))
+					{
+						polygon.inside(&blockx[0], &blocky[0], nblock, &blockmask[0]);
+						for (U32 k = 0; k < nblock; k++)
+						{
+							if (!blockmask[k]) continue;
+							if (reordered) accepted.push_back(std::make_pair((U32)lasreaderlasram->get_file_index(blockindices[k]), (U32)blockindices[k]));
+							else writebehind.write_record(output, blockrecordpointers[k]);
+						}
+						nblock = 0;
+					}
+				}
+				if (reordered) writeinfileorder(lasreaderlasram, accepted, &writebehind, output);
+				lasreaderlasram->set_decoding(TRUE);
+			}
+			else
+			{
+				BOOL more = TRUE;
+				while (more)
+				{
+					more = lasreader->read_point();
+					if (more)
+					{
+						lasreader->point.copy_to(&blockrecords[nblock * point_size]);
+						blockx[nblock] = (F64)lasreader->point.X;
+						blocky[nblock] = (F64)lasreader->point.Y;
+						nblock++;
+					}
+					if (nblock == LASCLIP_BLOCK_SIZE || (!more && nblock))
+					{
+						polygon.inside(&blockx[0], &blocky[0], nblock, &blockmask[0]);
+						for (U32 k = 0; k < nblock; k++)
+						{
+							if (blockmask[k]) writebehind.write_record(output, &blockrecords[k * point_size]);
+						}
+						nblock = 0;
+					}
+				}
+			}
+			writebehind.close(output);
+
+			if (verbose)
+				term_progress(std::cout, (ii + 1) / static_cast<double>(numberoffeatures));
+
+			ii++; //valid polygon counter
+		}
+		else
+		{
+			fprintf(stderr, "WARNING: not a polygon geometry, ignoring this geometry\n");
+		}
+
+		OGRFeature::DestroyFeature(poFeature);
+	}
+
+	//the outputs still reference the header of the reader, they are all
+	//written before it closes, even when clipping failed
+	U32 nfailed = (container ? writebehind.close_container() : writebehind.flush());
+	writebehind.remove_spill_files();
+	if (ii < 0) return -1;
+	if (nfailed)
+	{
+		fprintf(stderr, "ERROR: could not write all LAS output files\n");
+		return -1;
+	}
+	return ii;
+}
@@ -0,0 +1,140 @@
+/*
+===============================================================================
+
+FILE:  lasclipengine.h
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+Clipping engine of lasclip. A LAS file is clipped against the polygons of
+a SHAPEFILE, one output per polygon, with the same options as lasclip.
+Errors are reported and returned instead of ending the process, so that
+lasbatchclip can run the engine in-process, one engine per thread, each
+engine being reused from one LAS file to the next.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- LAX built in-process only when asked for with set_build_lax()
+17 October 2026 -- clip() against a layer of the caller, for the spatial join of lasbatchclip
+17 October 2026 -- created from lasclip to run it in-process in lasbatchclip
+
+===============================================================================
+*/
+
+#ifndef LAS_CLIP_ENGINE_H
+#define LAS_CLIP_ENGINE_H
+
+#include "lasreader.hpp"
+#include "laspolygon.h"
+#include "laswritebehind.h"
+#include <vector>
+#include <string>
+using namespace std;
+
+class OGRLayer;
+
+class LASclipEngine
+{
+public:
+	//options of the lasclip flags of the same names, they hold for all the
+	//next calls to clip()
+	inline void set_verbose(const BOOL verbose) { this->verbose = verbose; };
+	inline void set_single_pass(const BOOL single_pass) { this->single_pass = single_pass; };
+	inline void set_ram_index(const BOOL ram_index) { this->ram_index = ram_index; };
+	inline void set_build_lax(const BOOL build_lax) { this->build_lax = build_lax; };
+	inline void set_write_lax(const BOOL write_lax) { this->write_lax = write_lax; };
+	inline void set_lax_directory(const CHAR* lax_directory) { this->lax_directory = (lax_directory ? lax_directory : ""); };
+	inline void set_map_points(const BOOL map_points) { this->map_points = map_points; };
+	inline void set_container(const BOOL container) { this->container = container; };
+	inline void set_exact_size(const BOOL exact_size) { this->exact_size = exact_size; };
+	inline void set_max_memory(const I64 max_memory) { this->max_memory = max_memory; };
+	inline void set_threads(const U32 nthreads) { this->nthreads = (nthreads ? nthreads : 1); };
+	inline void set_io_threads(const U32 io_threads) { this->io_threads = io_threads; };
+	inline void set_io_buffer(const U32 io_buffer) { this->io_buffer = io_buffer; };
+	inline void set_io_max_memory(const I64 io_max_memory) { this->io_max_memory = io_max_memory; };
+	inline void set_format(const CHAR* format) { this->format = format; };
+	inline void set_field_index_name(const CHAR* field_index_name) { this->field_index_name = field_index_name; };
+
+	//registers the GDAL/OGR drivers, only once per process whatever the
+	//number of engines and threads calling it
+	static void init();
+
+	//clips the LAS file against the polygons of the layer named after the
+	//SHAPEFILE, writing the outputs into output_directory, which is created
+	//when missing. returns FALSE once the error has been reported.
+	BOOL clip(const CHAR* file_name, const CHAR* shapefile_name, const CHAR* output_directory);
+	//same against the polygons of a layer opened by the caller, which may
+	//gather the polygons of several SHAPEFILEs. the layer is only used by
+	//the calling thread.
+	BOOL clip(const CHAR* file_name, OGRLayer* poLayer, const CHAR* output_directory);
+
+	//polygons and points of the last LAS file clipped
+	inline I64 get_number_of_polygons() const { return npolygons; };
+	inline I64 get_number_of_points() const { return npoints; };
+
+	LASclipEngine();
+	~LASclipEngine();
+
+protected:
+	I64 clip_polygons(LASreader* lasreader, OGRLayer* poLayer, const std::string& output_directory, const std::string& scratch_directory, const std::string& file_name_only);
+
+	BOOL verbose;
+	BOOL single_pass;
+	BOOL ram_index;
+	BOOL build_lax;
+	BOOL write_lax;
+	std::string lax_directory;
+	BOOL map_points;
+	BOOL container;
+	BOOL exact_size;
+	I64 max_memory;
+	U32 nthreads;
+	U32 io_threads;
+	U32 io_buffer;
+	I64 io_max_memory;
+	std::string format;
+	std::string field_index_name;
+
+	I64 npolygons;
+	I64 npoints;
+
+	//kept from one LAS file to the next
+	LASwriteBehind writebehind;
+	LASpolygon polygon;
+	vector<F64> blockx;
+	vector<F64> blocky;
+	vector<U8> blockmask;
+	vector<const U8*> blockrecordpointers;
+	vector<I64> blockindices;
+	//points accepted by a polygon among those reordered by the cell index
+	vector< std::pair<U32, U32> > accepted;
+	vector<U8> blockrecords;
+};
+
+#endif
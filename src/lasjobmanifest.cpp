@@ -0,0 +1,400 @@
+/*
+===============================================================================
+
+FILE:  lasjobmanifest.cpp
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- outputs recorded by a hash of their names, none changed since the job
+17 October 2026 -- appended as a journal, the outputs counted once per directory listing
+17 October 2026 -- created for lasbatchclip to resume interrupted batches
+
+===============================================================================
+*/
+
+#include "lasjobmanifest.h"
+#include "lasappsutility.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm> //for sort() and lower_bound()
+#include <set>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h> //for MoveFileEx()
+#include <io.h> //for _commit()
+#include "dirent.h" //for opendir() and readdir()
+#else
+#include <unistd.h> //for fsync()
+#include <dirent.h>
+#endif
+
+#define LAS_JOB_MANIFEST_VERSION "# lasbatchclip manifest 2"
+//completed jobs and seconds after which their outputs are counted, that is
+//how much of a run a crash can lose at most
+#define LAS_JOB_MANIFEST_MAX_PENDING 64
+#define LAS_JOB_MANIFEST_MAX_PENDING_SECONDS 60
+
+//size and modification time of a file, FALSE if it cannot be found
+static BOOL getfilestat(const std::string& file_name, I64* size, I64* mtime)
+{
+#ifdef _WIN32
+	struct __stat64 st;
+	if (_stat64(file_name.c_str(), &st) != 0) return FALSE;
+#else
+	struct stat st;
+	if (stat(file_name.c_str(), &st) != 0) return FALSE;
+#endif
+	*size = (I64)st.st_size;
+	*mtime = (I64)st.st_mtime;
+	return TRUE;
+}
+
+//appends the size and modification time of a file, -1 for both if it
+//cannot be found
+static BOOL appendfilestat(std::string& signature, const std::string& file_name)
+{
+	I64 size = -1, mtime = -1;
+	BOOL found = getfilestat(file_name, &size, &mtime);
+	char temp[64];
+	sprintf(temp, "%.0f,%.0f,", (F64)size, (F64)mtime);
+	signature += temp;
+	return found;
+}
+
+//reads a line of any length, FALSE at the end of the file. a last line
+//without its new line was cut short by a crash.
+static BOOL readline(FILE* file, std::string& line, BOOL* complete)
+{
+	int c;
+	line.clear();
+	while ((c = getc(file)) != EOF && c != '\n')
+	{
+		if (c != '\r') line += (char)c;
+	}
+	*complete = (c == '\n');
+	return (c != EOF || !line.empty());
+}
+
+//the .las and .laz file names of a directory, sorted
+static void listoutputs(const std::string& output_directory, std::vector<std::string>& names)
+{
+	names.clear();
+	DIR* pDIR = opendir(output_directory.c_str());
+	if (pDIR == NULL) return;
+	struct dirent* pdirent;
+	while ((pdirent = readdir(pDIR)) != NULL)
+	{
+		std::string name = pdirent->d_name;
+		std::string ext = getextensiononly(name);
+		if (ext == "las" || ext == "LAS" || ext == "laz" || ext == "LAZ") names.push_back(name);
+	}
+	closedir(pDIR);
+	std::sort(names.begin(), names.end());
+}
+
+//FNV-1a hash of the sorted names of the outputs of a job
+static U64 hashnames(const std::vector<std::string>& names)
+{
+	U64 hash = 14695981039346656037ULL;
+	for (size_t n = 0; n < names.size(); n++)
+	{
+		//the terminating null separates the names
+		for (size_t c = 0; c <= names[n].size(); c++)
+		{
+			hash ^= (U8)names[n].c_str()[c];
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+LASjobManifest::LASjobManifest()
+{
+	pending_time = 0;
+	journal = 0;
+}
+
+LASjobManifest::~LASjobManifest()
+{
+	close();
+}
+
+BOOL LASjobManifest::open(const char* file_name)
+{
+	close();
+	this->file_name = file_name;
+	jobs.clear();
+	listings.clear();
+	las_names.clear();
+	FILE* file = fopen(file_name, "r");
+	std::string line;
+	BOOL complete;
+	U32 l = 0;
+	while (file && readline(file, line, &complete))
+	{
+		l++;
+		if (line.empty() || line[0] == '#' || !complete) continue;
+		//LAS file, SHAPEFILE, signature, output directory, number of outputs,
+		//hash of their names and completion time, the last two missing from
+		//the lines of manifests of version 1
+		size_t tab[6];
+		size_t t, from = 0;
+		for (t = 0; t < 6; t++)
+		{
+			tab[t] = line.find('\t', from);
+			if (tab[t] == std::string::npos) break;
+			from = tab[t] + 1;
+		}
+		if (t < 4)
+		{
+			fprintf(stderr, "WARNING: skipping line %u of manifest '%s'\n", l, file_name);
+			continue;
+		}
+		LASjobEntry entry;
+		entry.signature = line.substr(tab[1] + 1, tab[2] - tab[1] - 1);
+		entry.output_directory = line.substr(tab[2] + 1, tab[3] - tab[2] - 1);
+		entry.noutputs = atoi(line.c_str() + tab[3] + 1);
+		entry.hash = (t > 4 ? strtoull(line.c_str() + tab[4] + 1, 0, 16) : 0);
+		entry.done = (t > 5 ? strtoll(line.c_str() + tab[5] + 1, 0, 10) : 0);
+		//a job done again since is appended again, the last line holds
+		jobs[line.substr(0, tab[1])] = entry;
+		add_las_name(entry.output_directory, line.substr(0, tab[0]).c_str());
+	}
+	if (file) fclose(file);
+	//one line per job again, then the jobs of this run are appended
+	if (!write()) return FALSE;
+	journal = fopen(file_name, "a");
+	if (journal == 0)
+	{
+		fprintf(stderr, "ERROR: cannot open '%s' for append\n", file_name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+BOOL LASjobManifest::close()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	BOOL written = count_pending();
+	if (journal)
+	{
+		if (fclose(journal) != 0) written = FALSE;
+		journal = 0;
+	}
+	return written;
+}
+
+std::string LASjobManifest::signature(const char* las_file_name, const char* shape_file_name, const char* options)
+{
+	std::string signature;
+	if (!appendfilestat(signature, las_file_name)) return "";
+	if (!appendfilestat(signature, shape_file_name)) return "";
+	//the attributes and the index of the SHAPEFILE live next to it
+	std::string shape_file_base = shape_file_name;
+	size_t dot = shape_file_base.find_last_of(".");
+	if (dot != std::string::npos) shape_file_base = shape_file_base.substr(0, dot);
+	BOOL upper = (dot != std::string::npos && shape_file_name[dot + 1] == 'S');
+	appendfilestat(signature, shape_file_base + (upper ? ".DBF" : ".dbf"));
+	appendfilestat(signature, shape_file_base + (upper ? ".SHX" : ".shx"));
+	signature += options;
+	//tabs and new lines separate the fields of the manifest
+	for (size_t c = 0; c < signature.size(); c++)
+	{
+		if (signature[c] == '\t' || signature[c] == '\n' || signature[c] == '\r') signature[c] = ' ';
+	}
+	return signature;
+}
+
+void LASjobManifest::add_las_name(const std::string& output_directory, const char* las_file_name)
+{
+	las_names[output_directory].insert(getfilenameonly(las_file_name));
+}
+
+void LASjobManifest::match_outputs(const std::string& output_directory, const std::string& las_name, BOOL refresh, std::vector<std::string>& names)
+{
+	names.clear();
+	std::map< std::string, std::vector<std::string> >::iterator it = listings.find(output_directory);
+	if (it == listings.end())
+	{
+		it = listings.insert(std::make_pair(output_directory, std::vector<std::string>())).first;
+		refresh = TRUE;
+	}
+	if (refresh) listoutputs(output_directory, it->second);
+	//the outputs of the LAS files that this one prefixes are not its own
+	std::string prefix = las_name + "_";
+	std::vector<std::string> others;
+	const std::set<std::string>& siblings = las_names[output_directory];
+	std::set<std::string>::const_iterator sibling = siblings.lower_bound(prefix);
+	while (sibling != siblings.end() && sibling->compare(0, prefix.size(), prefix) == 0)
+	{
+		others.push_back(*sibling + "_");
+		++sibling;
+	}
+	//the outputs of a LAS file follow each other in the sorted listing
+	std::vector<std::string>::const_iterator name = std::lower_bound(it->second.begin(), it->second.end(), prefix);
+	while (name != it->second.end() && name->compare(0, prefix.size(), prefix) == 0)
+	{
+		size_t o;
+		for (o = 0; o < others.size(); o++)
+		{
+			if (name->compare(0, others[o].size(), others[o]) == 0) break;
+		}
+		if (o == others.size()) names.push_back(*name);
+		++name;
+	}
+}
+
+void LASjobManifest::print(FILE* file, const std::string& key, const LASjobEntry& entry)
+{
+#ifdef _WIN32
+	fprintf(file, "%s\t%s\t%s\t%d\t%016I64x\t%I64d\n", key.c_str(), entry.signature.c_str(), entry.output_directory.c_str(), entry.noutputs, entry.hash, entry.done);
+#else
+	fprintf(file, "%s\t%s\t%s\t%d\t%016llx\t%lld\n", key.c_str(), entry.signature.c_str(), entry.output_directory.c_str(), entry.noutputs, entry.hash, entry.done);
+#endif
+}
+
+//counts the outputs of the jobs completed since the last count, listing
+//each of their output directories once, and appends them to the manifest
+BOOL LASjobManifest::count_pending()
+{
+	if (pending.empty()) return TRUE;
+	std::set<std::string> listed;
+	std::vector<std::string> names;
+	for (size_t j = 0; j < pending.size(); j++)
+	{
+		const std::string& key = pending[j].first;
+		LASjobEntry& entry = pending[j].second;
+		BOOL refresh = listed.insert(entry.output_directory).second;
+		match_outputs(entry.output_directory, getfilenameonly(key.substr(0, key.find('\t'))), refresh, names);
+		entry.noutputs = (I32)names.size();
+		entry.hash = hashnames(names);
+		jobs[key] = entry;
+		if (journal) print(journal, key, entry);
+	}
+	pending.clear();
+	BOOL written = (journal != 0 && fflush(journal) == 0);
+#ifdef _WIN32
+	if (written) written = (_commit(_fileno(journal)) == 0);
+#else
+	if (written) written = (fsync(fileno(journal)) == 0);
+#endif
+	if (!written) fprintf(stderr, "ERROR: cannot write '%s'\n", file_name.c_str());
+	return written;
+}
+
+BOOL LASjobManifest::is_up_to_date(const char* las_file_name, const char* shape_file_name, const std::string& signature, const char* output_directory)
+{
+	if (signature.empty()) return FALSE;
+	std::lock_guard<std::mutex> lock(mutex);
+	//known before its outputs are matched, as those of the other jobs
+	add_las_name(output_directory, las_file_name);
+	std::map<std::string, LASjobEntry>::const_iterator it = jobs.find(std::string(las_file_name) + "\t" + shape_file_name);
+	if (it == jobs.end()) return FALSE;
+	const LASjobEntry& entry = it->second;
+	if (entry.signature != signature || entry.output_directory != output_directory) return FALSE;
+	//recorded by a manifest of version 1, without the names of the outputs
+	if (entry.done == 0) return FALSE;
+	std::vector<std::string> names;
+	match_outputs(entry.output_directory, getfilenameonly(las_file_name), FALSE, names);
+	if ((I32)names.size() != entry.noutputs || hashnames(names) != entry.hash) return FALSE;
+	//nor rewritten since, by another job or by hand
+	for (size_t n = 0; n < names.size(); n++)
+	{
+		I64 size, mtime;
+		if (!getfilestat(entry.output_directory + LAS_PATH_SEPARATOR + names[n], &size, &mtime) || mtime > entry.done) return FALSE;
+	}
+	return TRUE;
+}
+
+BOOL LASjobManifest::set_done(const char* las_file_name, const char* shape_file_name, const std::string& signature, const char* output_directory)
+{
+	if (signature.empty()) return FALSE;
+	LASjobEntry entry;
+	entry.signature = signature;
+	entry.output_directory = output_directory;
+	entry.noutputs = 0;
+	entry.hash = 0;
+	entry.done = (I64)time(0);
+	std::lock_guard<std::mutex> lock(mutex);
+	add_las_name(entry.output_directory, las_file_name);
+	if (pending.empty()) pending_time = (I64)time(0);
+	pending.push_back(std::make_pair(std::string(las_file_name) + "\t" + shape_file_name, entry));
+	if (pending.size() < LAS_JOB_MANIFEST_MAX_PENDING && (I64)time(0) - pending_time < LAS_JOB_MANIFEST_MAX_PENDING_SECONDS) return TRUE;
+	return count_pending();
+}
+
+BOOL LASjobManifest::write()
+{
+	//the new manifest is complete on disk before it replaces the previous
+	//one, a crash leaves either of them but never a mix
+	std::string temp_file_name = file_name + ".tmp";
+	FILE* file = fopen(temp_file_name.c_str(), "w");
+	if (file == 0)
+	{
+		fprintf(stderr, "ERROR: cannot open '%s' for write\n", temp_file_name.c_str());
+		return FALSE;
+	}
+	fprintf(file, "%s\n", LAS_JOB_MANIFEST_VERSION);
+	std::map<std::string, LASjobEntry>::const_iterator it;
+	for (it = jobs.begin(); it != jobs.end(); ++it) print(file, it->first, it->second);
+	BOOL written = (fflush(file) == 0);
+#ifdef _WIN32
+	if (written) written = (_commit(_fileno(file)) == 0);
+#else
+	if (written) written = (fsync(fileno(file)) == 0);
+#endif
+	if (fclose(file) != 0) written = FALSE;
+	if (!written)
+	{
+		fprintf(stderr, "ERROR: cannot write '%s'\n", temp_file_name.c_str());
+		remove(temp_file_name.c_str());
+		return FALSE;
+	}
+#ifdef _WIN32
+	if (!MoveFileExA(temp_file_name.c_str(), file_name.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		fprintf(stderr, "ERROR: MoveFileEx failed (%d) replacing '%s'\n", (int)GetLastError(), file_name.c_str());
+		return FALSE;
+	}
+#else
+	if (rename(temp_file_name.c_str(), file_name.c_str()) != 0)
+	{
+		fprintf(stderr, "ERROR: cannot rename '%s' to '%s'\n", temp_file_name.c_str(), file_name.c_str());
+		return FALSE;
+	}
+#endif
+	return TRUE;
+}
@@ -0,0 +1,128 @@
+/*
+===============================================================================
+
+FILE:  lasjobmanifest.h
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+Keeps track of the LAS file and SHAPEFILE pairs a batch has clipped, so
+that a batch run again only clips the pairs whose inputs, options or
+outputs changed since. The manifest is a text file with one line per
+completed job, appended as the jobs complete and compacted when opened,
+through a temporary file renamed over the previous one, so that it is never
+left half written. The outputs of the completed jobs are counted in batches,
+each output directory listed once per batch, and recorded by their number,
+a hash of their names and the time the job completed.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- outputs recorded by a hash of their names, none changed since the job
+17 October 2026 -- appended as a journal, the outputs counted once per directory listing
+17 October 2026 -- created for lasbatchclip to resume interrupted batches
+
+===============================================================================
+*/
+
+#ifndef LAS_JOB_MANIFEST_H
+#define LAS_JOB_MANIFEST_H
+
+#include "mydefs.hpp"
+#include <stdio.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <set>
+#include <mutex>
+using namespace std;
+
+class LASjobManifest
+{
+public:
+	//reads the jobs completed by previous runs, a missing manifest is empty,
+	//then compacts the manifest and opens it for appending
+	BOOL open(const char* file_name);
+	//records the jobs still to be counted and closes the manifest
+	BOOL close();
+
+	//sizes and modification times of the LAS file and of the SHAPEFILE with
+	//its .dbf and .shx, followed by the options. empty if the LAS file or the
+	//SHAPEFILE cannot be found.
+	static std::string signature(const char* las_file_name, const char* shape_file_name, const char* options);
+
+	//TRUE if the job completed before with the same signature and output
+	//directory, with the same outputs, none of them modified since
+	BOOL is_up_to_date(const char* las_file_name, const char* shape_file_name, const std::string& signature, const char* output_directory);
+	//records the job as completed along with its outputs, appended to the
+	//manifest once LAS_JOB_MANIFEST_MAX_PENDING jobs or at least
+	//LAS_JOB_MANIFEST_MAX_PENDING_SECONDS wait to be counted, or on close().
+	//may be called by several threads at once.
+	BOOL set_done(const char* las_file_name, const char* shape_file_name, const std::string& signature, const char* output_directory);
+
+	inline U32 get_number_of_jobs() const { return (U32)jobs.size(); };
+
+	LASjobManifest();
+	~LASjobManifest();
+
+protected:
+	BOOL write();
+	//the .las or .laz files clipped out of a LAS file, that is those named
+	//after it followed by '_' in the output directory, but not after another
+	//LAS file of the directory that it prefixes (tile_1 and tile_1_2), from
+	//the listing of the directory made once or refreshed when asked
+	void match_outputs(const std::string& output_directory, const std::string& las_name, BOOL refresh, std::vector<std::string>& names);
+	//registers the LAS file of a job whose outputs go to output_directory
+	void add_las_name(const std::string& output_directory, const char* las_file_name);
+	BOOL count_pending();
+	struct LASjobEntry
+	{
+		std::string signature;
+		std::string output_directory;
+		I32 noutputs;
+		//of the sorted names of the outputs
+		U64 hash;
+		//when the job completed, its outputs are older
+		I64 done;
+	};
+	static void print(FILE* file, const std::string& key, const LASjobEntry& entry);
+	//keyed by LAS file name and SHAPEFILE name, separated by a tab
+	std::map<std::string, LASjobEntry> jobs;
+	//completed jobs whose outputs are not counted yet
+	std::vector< std::pair<std::string, LASjobEntry> > pending;
+	I64 pending_time;
+	//sorted .las and .laz file names of each output directory
+	std::map< std::string, std::vector<std::string> > listings;
+	//names of the LAS files of the known jobs of each output directory
+	std::map< std::string, std::set<std::string> > las_names;
+	std::string file_name;
+	FILE* journal;
+	std::mutex mutex;
+};
+
+#endif
@@ -0,0 +1,292 @@
+/*
+===============================================================================
+
+FILE:  laslauncher.cpp
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- created for lasbatchclip to launch lasclip on Linux too
+
+===============================================================================
+*/
+
+#include "laslauncher.h"
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h> //for GetProcessMemoryInfo()
+#else
+#include <spawn.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+extern char** environ;
+#endif
+
+static double launchertime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string commandline(const vector<string>& command)
+{
+	std::string line;
+	for (size_t a = 0; a < command.size(); a++)
+	{
+		if (a) line += " ";
+		if (command[a].empty() || command[a].find_first_of(" \t") != std::string::npos) line += "\"" + command[a] + "\"";
+		else line += command[a];
+	}
+	return line;
+}
+
+LASlauncher::LASlauncher()
+{
+	max_children = 1;
+	retries = 0;
+	verbose = false;
+}
+
+LASlauncher::~LASlauncher()
+{
+}
+
+int LASlauncher::run(const vector< vector<string> >& commands, vector<LASlaunchResult>& results)
+{
+	size_t c;
+	LASlaunchResult launchresult;
+	launchresult.exit_code = -1;
+	launchresult.attempts = 0;
+	launchresult.wall_time = 0.0;
+	launchresult.user_time = 0.0;
+	launchresult.system_time = 0.0;
+	launchresult.max_rss = 0;
+	results.assign(commands.size(), launchresult);
+
+	//commands waiting to be launched, in order, failed ones go back at the end
+	std::deque<size_t> waiting;
+	for (c = 0; c < commands.size(); c++)
+	{
+		if (commands[c].empty()) fprintf(stderr, "ERROR: command %u is empty\n", (unsigned int)c);
+		else waiting.push_back(c);
+	}
+
+	struct LASchild
+	{
+#ifdef _WIN32
+		HANDLE process;
+#else
+		pid_t pid;
+#endif
+		size_t command;
+		double start;
+	};
+	vector<LASchild> children;
+	int nchildren = max_children;
+#ifdef _WIN32
+	if (nchildren > MAXIMUM_WAIT_OBJECTS)
+	{
+		fprintf(stderr, "WARNING: at most %d children are waited for at once\n", MAXIMUM_WAIT_OBJECTS);
+		nchildren = MAXIMUM_WAIT_OBJECTS;
+	}
+#else
+	//posix_spawn() cannot set the directory of the child portably, the
+	//children all start in the directory of the parent, which is moved
+	std::string previous_directory;
+	if (!working_directory.empty())
+	{
+		char buffer[4096];
+		if (getcwd(buffer, sizeof(buffer)) == 0 || chdir(working_directory.c_str()) != 0)
+		{
+			fprintf(stderr, "ERROR: cannot change to working directory '%s'\n", working_directory.c_str());
+			return (int)commands.size();
+		}
+		previous_directory = buffer;
+	}
+#endif
+
+	while (waiting.size() || children.size())
+	{
+		//////////////////////////////////////////
+		//launch commands until the cap is reached
+		//////////////////////////////////////////
+		while ((int)children.size() < nchildren && waiting.size())
+		{
+			c = waiting.front();
+			waiting.pop_front();
+			LASlaunchResult& result = results[c];
+			result.attempts++;
+			if (verbose) fprintf(stderr, "launching %s\n", commandline(commands[c]).c_str());
+			LASchild child;
+			child.command = c;
+			child.start = launchertime();
+#ifdef _WIN32
+			std::string line = commandline(commands[c]);
+			STARTUPINFOA si;
+			PROCESS_INFORMATION pi;
+			ZeroMemory(&si, sizeof(si));
+			si.cb = sizeof(si);
+			ZeroMemory(&pi, sizeof(pi));
+			if (!CreateProcessA(NULL, const_cast<char*>(line.c_str()), NULL, NULL, FALSE, HIGH_PRIORITY_CLASS, NULL, (working_directory.empty() ? NULL : working_directory.c_str()), &si, &pi))
+			{
+				fprintf(stderr, "ERROR: CreateProcess failed (%d) for %s\n", (int)GetLastError(), line.c_str());
+				result.exit_code = -1;
+				if (result.attempts <= retries) waiting.push_back(c);
+				else if (on_done) on_done(c, result);
+				continue;
+			}
+			CloseHandle(pi.hThread);
+			child.process = pi.hProcess;
+#else
+			vector<char*> argv;
+			for (size_t a = 0; a < commands[c].size(); a++) argv.push_back(const_cast<char*>(commands[c][a].c_str()));
+			argv.push_back(0);
+			int error = posix_spawnp(&child.pid, argv[0], 0, 0, &argv[0], environ);
+			if (error != 0)
+			{
+				fprintf(stderr, "ERROR: posix_spawn failed (%s) for %s\n", strerror(error), commandline(commands[c]).c_str());
+				result.exit_code = -1;
+				if (result.attempts <= retries) waiting.push_back(c);
+				else if (on_done) on_done(c, result);
+				continue;
+			}
+#endif
+			children.push_back(child);
+		}
+		if (children.empty()) break;
+
+		//////////////////////////////////
+		//reap whichever child ends first
+		//////////////////////////////////
+		size_t k;
+		int exit_code;
+		double user_time = 0.0, system_time = 0.0;
+		long long max_rss = 0;
+#ifdef _WIN32
+		vector<HANDLE> handles(children.size());
+		for (k = 0; k < children.size(); k++) handles[k] = children[k].process;
+		DWORD signaled = WaitForMultipleObjects((DWORD)handles.size(), &handles[0], FALSE, INFINITE);
+		if (signaled >= WAIT_OBJECT_0 + handles.size())
+		{
+			fprintf(stderr, "ERROR: WaitForMultipleObjects failed (%d)\n", (int)GetLastError());
+			break;
+		}
+		k = signaled - WAIT_OBJECT_0;
+		HANDLE process = children[k].process;
+		DWORD code = 0;
+		exit_code = (GetExitCodeProcess(process, &code) ? (int)code : -1);
+		FILETIME creation, exited, kernel, user;
+		if (GetProcessTimes(process, &creation, &exited, &kernel, &user))
+		{
+			user_time = (((unsigned long long)user.dwHighDateTime << 32) | user.dwLowDateTime) * 1e-7;
+			system_time = (((unsigned long long)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) * 1e-7;
+		}
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(process, &counters, sizeof(counters))) max_rss = (long long)(counters.PeakWorkingSetSize / 1024);
+		CloseHandle(process);
+#else
+		int status;
+		struct rusage usage;
+		pid_t pid = wait4(-1, &status, 0, &usage);
+		if (pid == -1)
+		{
+			if (errno == EINTR) continue;
+			fprintf(stderr, "ERROR: wait4 failed (%s)\n", strerror(errno));
+			break;
+		}
+		for (k = 0; k < children.size(); k++)
+		{
+			if (children[k].pid == pid) break;
+		}
+		if (k == children.size()) continue;
+		if (WIFEXITED(status)) exit_code = WEXITSTATUS(status);
+		else if (WIFSIGNALED(status)) exit_code = 128 + WTERMSIG(status);
+		else exit_code = -1;
+		user_time = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6;
+		system_time = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#ifdef __APPLE__
+		max_rss = (long long)usage.ru_maxrss / 1024;
+#else
+		max_rss = (long long)usage.ru_maxrss;
+#endif
+#endif
+		c = children[k].command;
+		LASlaunchResult& result = results[c];
+		result.exit_code = exit_code;
+		result.wall_time = launchertime() - children[k].start;
+		result.user_time = user_time;
+		result.system_time = system_time;
+		result.max_rss = max_rss;
+		children.erase(children.begin() + k);
+		if (exit_code != 0)
+		{
+			if (result.attempts <= retries)
+			{
+				fprintf(stderr, "WARNING: %s failed with exit code %d, launching it again\n", commandline(commands[c]).c_str(), exit_code);
+				waiting.push_back(c);
+			}
+			else
+			{
+				fprintf(stderr, "ERROR: %s failed with exit code %d\n", commandline(commands[c]).c_str(), exit_code);
+				if (on_done) on_done(c, result);
+			}
+		}
+		else if (on_done)
+		{
+			on_done(c, result);
+		}
+	}
+
+	//children left behind by a failed wait are not waited for again
+#ifdef _WIN32
+	for (size_t k = 0; k < children.size(); k++) CloseHandle(children[k].process);
+#else
+	if (!previous_directory.empty() && chdir(previous_directory.c_str()) != 0)
+	{
+		fprintf(stderr, "WARNING: cannot change back to directory '%s'\n", previous_directory.c_str());
+	}
+#endif
+
+	int nfailed = 0;
+	for (c = 0; c < results.size(); c++)
+	{
+		if (results[c].exit_code != 0) nfailed++;
+	}
+	return nfailed;
+}
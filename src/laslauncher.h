@@ -0,0 +1,100 @@
+/*
+===============================================================================
+
+FILE:  laslauncher.h
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+Launches child processes, at most a given number at once, and collects
+their exit code and resource usage. Failed children may be launched again.
+Children are spawned with posix_spawn() and reaped with wait4() on POSIX
+systems, and created with CreateProcess() and waited for with
+WaitForMultipleObjects() on Windows.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- set_on_done() to record commands as they complete
+17 October 2026 -- created for lasbatchclip to launch lasclip on Linux too
+
+===============================================================================
+*/
+
+#ifndef LAS_LAUNCHER_H
+#define LAS_LAUNCHER_H
+
+#include <vector>
+#include <string>
+#include <functional>
+using namespace std;
+
+//outcome of a command, for its last attempt
+struct LASlaunchResult
+{
+	//exit code of the child, 128 plus the signal number when killed by a
+	//signal, -1 when the child could not be launched
+	int exit_code;
+	int attempts;
+	double wall_time;
+	double user_time;
+	double system_time;
+	//peak resident set size (peak working set on Windows) in KB
+	long long max_rss;
+};
+
+class LASlauncher
+{
+public:
+	inline void set_max_children(const int max_children) { this->max_children = (max_children > 0 ? max_children : 1); };
+	//a command failing is launched again, up to retries more times
+	inline void set_retries(const int retries) { this->retries = (retries > 0 ? retries : 0); };
+	//working directory of the children, the current one when empty
+	inline void set_working_directory(const char* working_directory) { this->working_directory = (working_directory ? working_directory : ""); };
+	inline void set_verbose(const bool verbose) { this->verbose = verbose; };
+	//called from run() with the index of a command and its result once it
+	//succeeded or ran out of retries
+	inline void set_on_done(const std::function<void(size_t, const LASlaunchResult&)>& on_done) { this->on_done = on_done; };
+
+	//runs the commands in order, each one given as its program followed by
+	//its arguments, keeping at most max_children of them running. results
+	//are set per command. returns the number of commands that failed.
+	int run(const vector< vector<string> >& commands, vector<LASlaunchResult>& results);
+
+	LASlauncher();
+	~LASlauncher();
+
+protected:
+	int max_children;
+	int retries;
+	std::string working_directory;
+	bool verbose;
+	std::function<void(size_t, const LASlaunchResult&)> on_done;
+};
+
+#endif
@@ -0,0 +1,421 @@
+/*
+===============================================================================
+
+FILE:  laspolygon.cpp
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- created to replace OGRPoint::Within() in lasclip
+
+===============================================================================
+*/
+
+#include "laspolygon.h"
+#include "ogrsf_frmts.h"
+#include "lasdefinitions.hpp"
+#include <math.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LAS_POLYGON_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+//the AVX-512 intrinsics need Visual Studio 2017 or gcc 5
+#if (defined(_MSC_VER) && (_MSC_VER >= 1911)) || (defined(__GNUC__) && (__GNUC__ >= 5)) || defined(__clang__)
+#define LAS_POLYGON_AVX512
+#endif
+#endif
+
+//Visual Studio compiles intrinsics for any instruction set, gcc needs the
+//target spelled out per function. fused multiply-adds must stay off, the
+//block kernels have to round exactly like the single point test.
+#if defined(LAS_POLYGON_X86) && defined(__GNUC__)
+#if !defined(__clang__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+#define LAS_TARGET_AVX __attribute__((target("avx")))
+#define LAS_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define LAS_TARGET_AVX
+#define LAS_TARGET_AVX512
+#endif
+
+//a block kernel tests the points of n / lanes full vectors, the polygon
+//takes care of the remaining points one at a time
+typedef U32 (*LASpolygonKernel)(const F64* ex1, const F64* ey1, const F64* ex2, const F64* ey2, const U32 nedges, const F64* envelope, const F64* x, const F64* y, const U32 n, U8* mask);
+
+#ifdef LAS_POLYGON_X86
+
+static U32 inside_sse2(const F64* ex1, const F64* ey1, const F64* ex2, const F64* ey2, const U32 nedges, const F64* envelope, const F64* x, const F64* y, const U32 n, U8* mask)
+{
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d min_x = _mm_set1_pd(envelope[0]);
+	const __m128d min_y = _mm_set1_pd(envelope[1]);
+	const __m128d max_x = _mm_set1_pd(envelope[2]);
+	const __m128d max_y = _mm_set1_pd(envelope[3]);
+	U32 i;
+	for (i = 0; i + 2 <= n; i += 2)
+	{
+		__m128d px = _mm_loadu_pd(x + i);
+		__m128d py = _mm_loadu_pd(y + i);
+		__m128d env = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(px, min_x), _mm_cmple_pd(px, max_x)), _mm_and_pd(_mm_cmpge_pd(py, min_y), _mm_cmple_pd(py, max_y)));
+		if (_mm_movemask_pd(env) == 0)
+		{
+			mask[i] = mask[i + 1] = 0;
+			continue;
+		}
+		__m128d in = zero;
+		__m128d boundary = zero;
+		for (U32 e = 0; e < nedges; e++)
+		{
+			F64 dxs = ex2[e] - ex1[e];
+			F64 dys = ey2[e] - ey1[e];
+			__m128d x1 = _mm_set1_pd(ex1[e]);
+			__m128d y1 = _mm_set1_pd(ey1[e]);
+			__m128d y2 = _mm_set1_pd(ey2[e]);
+			__m128d cross = _mm_sub_pd(_mm_mul_pd(_mm_set1_pd(dxs), _mm_sub_pd(py, y1)), _mm_mul_pd(_mm_sub_pd(px, x1), _mm_set1_pd(dys)));
+			__m128d lo_x = _mm_set1_pd(ex1[e] < ex2[e] ? ex1[e] : ex2[e]);
+			__m128d hi_x = _mm_set1_pd(ex1[e] < ex2[e] ? ex2[e] : ex1[e]);
+			__m128d lo_y = _mm_set1_pd(ey1[e] < ey2[e] ? ey1[e] : ey2[e]);
+			__m128d hi_y = _mm_set1_pd(ey1[e] < ey2[e] ? ey2[e] : ey1[e]);
+			__m128d onedge = _mm_and_pd(_mm_cmpeq_pd(cross, zero), _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(px, lo_x), _mm_cmple_pd(px, hi_x)), _mm_and_pd(_mm_cmpge_pd(py, lo_y), _mm_cmple_pd(py, hi_y))));
+			boundary = _mm_or_pd(boundary, onedge);
+			__m128d straddle = _mm_xor_pd(_mm_cmpgt_pd(y1, py), _mm_cmpgt_pd(y2, py));
+			__m128d left = (dys > 0.0 ? _mm_cmpgt_pd(cross, zero) : _mm_cmple_pd(cross, zero));
+			in = _mm_xor_pd(in, _mm_and_pd(straddle, left));
+		}
+		int bits = _mm_movemask_pd(_mm_andnot_pd(boundary, _mm_and_pd(in, env)));
+		mask[i] = (U8)(bits & 1);
+		mask[i + 1] = (U8)((bits >> 1) & 1);
+	}
+	return i;
+}
+
+LAS_TARGET_AVX static U32 inside_avx(const F64* ex1, const F64* ey1, const F64* ex2, const F64* ey2, const U32 nedges, const F64* envelope, const F64* x, const F64* y, const U32 n, U8* mask)
+{
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d min_x = _mm256_set1_pd(envelope[0]);
+	const __m256d min_y = _mm256_set1_pd(envelope[1]);
+	const __m256d max_x = _mm256_set1_pd(envelope[2]);
+	const __m256d max_y = _mm256_set1_pd(envelope[3]);
+	U32 i, k;
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		__m256d px = _mm256_loadu_pd(x + i);
+		__m256d py = _mm256_loadu_pd(y + i);
+		__m256d env = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(px, min_x, _CMP_GE_OQ), _mm256_cmp_pd(px, max_x, _CMP_LE_OQ)), _mm256_and_pd(_mm256_cmp_pd(py, min_y, _CMP_GE_OQ), _mm256_cmp_pd(py, max_y, _CMP_LE_OQ)));
+		if (_mm256_movemask_pd(env) == 0)
+		{
+			for (k = 0; k < 4; k++) mask[i + k] = 0;
+			continue;
+		}
+		__m256d in = zero;
+		__m256d boundary = zero;
+		for (U32 e = 0; e < nedges; e++)
+		{
+			F64 dxs = ex2[e] - ex1[e];
+			F64 dys = ey2[e] - ey1[e];
+			__m256d x1 = _mm256_set1_pd(ex1[e]);
+			__m256d y1 = _mm256_set1_pd(ey1[e]);
+			__m256d y2 = _mm256_set1_pd(ey2[e]);
+			__m256d cross = _mm256_sub_pd(_mm256_mul_pd(_mm256_set1_pd(dxs), _mm256_sub_pd(py, y1)), _mm256_mul_pd(_mm256_sub_pd(px, x1), _mm256_set1_pd(dys)));
+			__m256d lo_x = _mm256_set1_pd(ex1[e] < ex2[e] ? ex1[e] : ex2[e]);
+			__m256d hi_x = _mm256_set1_pd(ex1[e] < ex2[e] ? ex2[e] : ex1[e]);
+			__m256d lo_y = _mm256_set1_pd(ey1[e] < ey2[e] ? ey1[e] : ey2[e]);
+			__m256d hi_y = _mm256_set1_pd(ey1[e] < ey2[e] ? ey2[e] : ey1[e]);
+			__m256d onedge = _mm256_and_pd(_mm256_cmp_pd(cross, zero, _CMP_EQ_OQ), _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(px, lo_x, _CMP_GE_OQ), _mm256_cmp_pd(px, hi_x, _CMP_LE_OQ)), _mm256_and_pd(_mm256_cmp_pd(py, lo_y, _CMP_GE_OQ), _mm256_cmp_pd(py, hi_y, _CMP_LE_OQ))));
+			boundary = _mm256_or_pd(boundary, onedge);
+			__m256d straddle = _mm256_xor_pd(_mm256_cmp_pd(y1, py, _CMP_GT_OQ), _mm256_cmp_pd(y2, py, _CMP_GT_OQ));
+			__m256d left = (dys > 0.0 ? _mm256_cmp_pd(cross, zero, _CMP_GT_OQ) : _mm256_cmp_pd(cross, zero, _CMP_LE_OQ));
+			in = _mm256_xor_pd(in, _mm256_and_pd(straddle, left));
+		}
+		int bits = _mm256_movemask_pd(_mm256_andnot_pd(boundary, _mm256_and_pd(in, env)));
+		for (k = 0; k < 4; k++) mask[i + k] = (U8)((bits >> k) & 1);
+	}
+	return i;
+}
+
+#ifdef LAS_POLYGON_AVX512
+LAS_TARGET_AVX512 static U32 inside_avx512(const F64* ex1, const F64* ey1, const F64* ex2, const F64* ey2, const U32 nedges, const F64* envelope, const F64* x, const F64* y, const U32 n, U8* mask)
+{
+	const __m512d zero = _mm512_setzero_pd();
+	const __m512d min_x = _mm512_set1_pd(envelope[0]);
+	const __m512d min_y = _mm512_set1_pd(envelope[1]);
+	const __m512d max_x = _mm512_set1_pd(envelope[2]);
+	const __m512d max_y = _mm512_set1_pd(envelope[3]);
+	U32 i, k;
+	for (i = 0; i + 8 <= n; i += 8)
+	{
+		__m512d px = _mm512_loadu_pd(x + i);
+		__m512d py = _mm512_loadu_pd(y + i);
+		__mmask8 env = _mm512_cmp_pd_mask(px, min_x, _CMP_GE_OQ) & _mm512_cmp_pd_mask(px, max_x, _CMP_LE_OQ) & _mm512_cmp_pd_mask(py, min_y, _CMP_GE_OQ) & _mm512_cmp_pd_mask(py, max_y, _CMP_LE_OQ);
+		if (env == 0)
+		{
+			for (k = 0; k < 8; k++) mask[i + k] = 0;
+			continue;
+		}
+		__mmask8 in = 0;
+		__mmask8 boundary = 0;
+		for (U32 e = 0; e < nedges; e++)
+		{
+			F64 dxs = ex2[e] - ex1[e];
+			F64 dys = ey2[e] - ey1[e];
+			__m512d x1 = _mm512_set1_pd(ex1[e]);
+			__m512d y1 = _mm512_set1_pd(ey1[e]);
+			__m512d y2 = _mm512_set1_pd(ey2[e]);
+			__m512d cross = _mm512_sub_pd(_mm512_mul_pd(_mm512_set1_pd(dxs), _mm512_sub_pd(py, y1)), _mm512_mul_pd(_mm512_sub_pd(px, x1), _mm512_set1_pd(dys)));
+			__m512d lo_x = _mm512_set1_pd(ex1[e] < ex2[e] ? ex1[e] : ex2[e]);
+			__m512d hi_x = _mm512_set1_pd(ex1[e] < ex2[e] ? ex2[e] : ex1[e]);
+			__m512d lo_y = _mm512_set1_pd(ey1[e] < ey2[e] ? ey1[e] : ey2[e]);
+			__m512d hi_y = _mm512_set1_pd(ey1[e] < ey2[e] ? ey2[e] : ey1[e]);
+			boundary |= _mm512_cmp_pd_mask(cross, zero, _CMP_EQ_OQ) & _mm512_cmp_pd_mask(px, lo_x, _CMP_GE_OQ) & _mm512_cmp_pd_mask(px, hi_x, _CMP_LE_OQ) & _mm512_cmp_pd_mask(py, lo_y, _CMP_GE_OQ) & _mm512_cmp_pd_mask(py, hi_y, _CMP_LE_OQ);
+			__mmask8 straddle = _mm512_cmp_pd_mask(y1, py, _CMP_GT_OQ) ^ _mm512_cmp_pd_mask(y2, py, _CMP_GT_OQ);
+			__mmask8 left = (dys > 0.0 ? _mm512_cmp_pd_mask(cross, zero, _CMP_GT_OQ) : _mm512_cmp_pd_mask(cross, zero, _CMP_LE_OQ));
+			in ^= (straddle & left);
+		}
+		U32 bits = (U32)(in & env & ~boundary);
+		for (k = 0; k < 8; k++) mask[i + k] = (U8)((bits >> k) & 1);
+	}
+	return i;
+}
+#endif
+
+static void las_cpuid(int info[4], int leaf, int subleaf)
+{
+#if defined(_MSC_VER)
+	__cpuidex(info, leaf, subleaf);
+#else
+	__cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+#endif
+}
+
+static U64 las_xgetbv()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	U32 eax, edx;
+	__asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((U64)edx << 32) | eax;
+#endif
+}
+
+#endif
+
+static const CHAR* kernel_name = "scalar";
+
+//picks the widest kernel that both the CPU and the operating system (which
+//must save the wider registers, as reported by XGETBV) support
+static LASpolygonKernel select_kernel()
+{
+#ifdef LAS_POLYGON_X86
+	int info[4];
+	las_cpuid(info, 0, 0);
+	int nleaves = info[0];
+	las_cpuid(info, 1, 0);
+	BOOL osxsave = (info[2] >> 27) & 1;
+	BOOL avx = (info[2] >> 28) & 1;
+	U64 xcr0 = (osxsave ? las_xgetbv() : 0);
+	if (avx && ((xcr0 & 0x06) == 0x06))
+	{
+#ifdef LAS_POLYGON_AVX512
+		if (nleaves >= 7)
+		{
+			las_cpuid(info, 7, 0);
+			BOOL avx512f = (info[1] >> 16) & 1;
+			if (avx512f && ((xcr0 & 0xE6) == 0xE6))
+			{
+				kernel_name = "AVX-512F";
+				return inside_avx512;
+			}
+		}
+#endif
+		kernel_name = "AVX";
+		return inside_avx;
+	}
+	kernel_name = "SSE2";
+	return inside_sse2;
+#else
+	return 0;
+#endif
+}
+
+static const LASpolygonKernel kernel = select_kernel();
+
+LASpolygon::LASpolygon()
+{
+	quantized = FALSE;
+	min_x = min_y = 1.0;
+	max_x = max_y = 0.0;
+	min_X = min_Y = 1;
+	max_X = max_Y = 0;
+}
+
+//whole units inside [min, max], clamped to the range of I32
+static I32 quantize_ceil(const F64 v)
+{
+	F64 q = ceil(v);
+	if (q < (F64)I32_MIN) return I32_MIN;
+	if (q > (F64)I32_MAX) return I32_MAX;
+	return (I32)q;
+}
+
+static I32 quantize_floor(const F64 v)
+{
+	F64 q = floor(v);
+	if (q < (F64)I32_MIN) return I32_MIN;
+	if (q > (F64)I32_MAX) return I32_MAX;
+	return (I32)q;
+}
+
+LASpolygon::~LASpolygon()
+{
+}
+
+void LASpolygon::add_ring(const F64* x, const F64* y, const U32 npoints)
+{
+	U32 i, j;
+	for (i = 0; i < npoints; i++)
+	{
+		//rings are closed, but do not rely on it
+		j = (i + 1 < npoints ? i + 1 : 0);
+		//zero length edges never cross nor add to the boundary
+		if (x[i] == x[j] && y[i] == y[j]) continue;
+		edge_x1.push_back(x[i]);
+		edge_y1.push_back(y[i]);
+		edge_x2.push_back(x[j]);
+		edge_y2.push_back(y[j]);
+		if (x[i] < min_x) min_x = x[i];
+		if (x[i] > max_x) max_x = x[i];
+		if (y[i] < min_y) min_y = y[i];
+		if (y[i] > max_y) max_y = y[i];
+	}
+}
+
+BOOL LASpolygon::setup(const OGRGeometry* geometry, const LASquantizer* quantizer)
+{
+	quantized = (quantizer != 0);
+	edge_x1.clear();
+	edge_y1.clear();
+	edge_x2.clear();
+	edge_y2.clear();
+	min_x = min_y = 1.7976931348623157e+308;
+	max_x = max_y = -1.7976931348623157e+308;
+	min_X = min_Y = 1;
+	max_X = max_Y = 0;
+
+	if (geometry == NULL) return FALSE;
+
+	//collect the polygons, a single one or all those of a multipolygon
+	vector<const OGRPolygon*> polygons;
+	OGRwkbGeometryType type = wkbFlatten(geometry->getGeometryType());
+	if (type == wkbPolygon)
+	{
+		polygons.push_back((const OGRPolygon*)geometry);
+	}
+	else if (type == wkbMultiPolygon)
+	{
+		const OGRMultiPolygon* multipolygon = (const OGRMultiPolygon*)geometry;
+		for (int g = 0; g < multipolygon->getNumGeometries(); g++)
+		{
+			const OGRGeometry* part = multipolygon->getGeometryRef(g);
+			if (part && wkbFlatten(part->getGeometryType()) == wkbPolygon) polygons.push_back((const OGRPolygon*)part);
+		}
+	}
+
+	//outer rings and holes all contribute edges, the crossing parity takes
+	//care of holes and of the disjoint parts of a multipolygon
+	vector<F64> x;
+	vector<F64> y;
+	for (size_t p = 0; p < polygons.size(); p++)
+	{
+		int nrings = polygons[p]->getNumInteriorRings() + 1;
+		for (int r = 0; r < nrings; r++)
+		{
+			const OGRLinearRing* ring = (r == 0 ? polygons[p]->getExteriorRing() : polygons[p]->getInteriorRing(r - 1));
+			if (ring == NULL || ring->getNumPoints() < 3) continue;
+			int npoints = ring->getNumPoints();
+			x.resize(npoints);
+			y.resize(npoints);
+			for (int i = 0; i < npoints; i++)
+			{
+				x[i] = ring->getX(i);
+				y[i] = ring->getY(i);
+			}
+			if (quantizer)
+			{
+				for (int i = 0; i < npoints; i++)
+				{
+					x[i] = (x[i] - quantizer->x_offset) / quantizer->x_scale_factor;
+					y[i] = (y[i] - quantizer->y_offset) / quantizer->y_scale_factor;
+				}
+			}
+			add_ring(&x[0], &y[0], (U32)npoints);
+		}
+	}
+
+	if (edge_x1.empty())
+	{
+		min_x = min_y = 1.0;
+		max_x = max_y = 0.0;
+		min_X = min_Y = 1;
+		max_X = max_Y = 0;
+		return FALSE;
+	}
+	min_X = quantize_ceil(min_x);
+	min_Y = quantize_ceil(min_y);
+	max_X = quantize_floor(max_x);
+	max_Y = quantize_floor(max_y);
+	return TRUE;
+}
+
+void LASpolygon::inside(const F64* x, const F64* y, const U32 n, U8* mask) const
+{
+	U32 i = 0;
+	if (kernel && !edge_x1.empty())
+	{
+		F64 envelope[4] = { min_x, min_y, max_x, max_y };
+		i = kernel(&edge_x1[0], &edge_y1[0], &edge_x2[0], &edge_y2[0], (U32)edge_x1.size(), envelope, x, y, n, mask);
+	}
+	for (; i < n; i++)
+	{
+		mask[i] = (inside(x[i], y[i]) ? 1 : 0);
+	}
+}
+
+const CHAR* LASpolygon::get_kernel_name()
+{
+	return kernel_name;
+}
@@ -0,0 +1,147 @@
+/*
+===============================================================================
+
+FILE:  laspolygon.h
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+Prepared polygon for point-in-polygon tests. The rings (outer rings and
+holes) of an OGR polygon or multipolygon are flattened once into a list
+of edges that a crossing number test then runs against. Points lying on
+the boundary are reported outside, as OGRPoint::Within() does.
+
+Blocks of points can be tested at once by a vectorized kernel (AVX-512F,
+AVX or SSE2, chosen at runtime from the CPU features) that evaluates
+several points per edge in the lanes of a vector register.
+
+Given the quantizer of a LAS header, the polygon is set up in the integer
+coordinate space of the points, so that their raw X and Y are tested as
+they are, without the scale and offset of get_x() and get_y().
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- optional setup in the quantized space of LAS points
+17 October 2026 -- created to replace OGRPoint::Within() in lasclip
+
+===============================================================================
+*/
+
+#ifndef LAS_POLYGON_H
+#define LAS_POLYGON_H
+
+#include "mydefs.hpp"
+#include <vector>
+using namespace std;
+
+class OGRGeometry;
+class LASquantizer;
+
+class LASpolygon
+{
+public:
+	//accepts wkbPolygon and wkbMultiPolygon geometries. with a quantizer, the
+	//vertices are mapped to (x - offset) / scale once and the polygon is then
+	//tested against quantized point coordinates, as integers or as F64.
+	BOOL setup(const OGRGeometry* geometry, const LASquantizer* quantizer = 0);
+	inline BOOL is_quantized() const { return quantized; };
+
+	inline F64 get_min_x() const { return min_x; };
+	inline F64 get_min_y() const { return min_y; };
+	inline F64 get_max_x() const { return max_x; };
+	inline F64 get_max_y() const { return max_y; };
+	inline I32 get_min_X() const { return min_X; };
+	inline I32 get_min_Y() const { return min_Y; };
+	inline I32 get_max_X() const { return max_X; };
+	inline I32 get_max_Y() const { return max_Y; };
+	inline U32 get_number_of_edges() const { return (U32)edge_x1.size(); };
+
+	//crossing number test, a horizontal ray is cast from (x,y) towards +x and
+	//an edge is crossed when x lies left of it, that is when the sign of the
+	//cross product matches the edge direction. no division is needed and a
+	//zero cross product within the edge's bounding box marks the boundary.
+	inline BOOL inside(const F64 x, const F64 y) const
+	{
+		if (x < min_x || x > max_x || y < min_y || y > max_y) return FALSE;
+		BOOL in = FALSE;
+		const U32 n = (U32)edge_x1.size();
+		const F64* x1 = &edge_x1[0];
+		const F64* y1 = &edge_y1[0];
+		const F64* x2 = &edge_x2[0];
+		const F64* y2 = &edge_y2[0];
+		for (U32 e = 0; e < n; e++)
+		{
+			F64 dx = x2[e] - x1[e];
+			F64 dy = y2[e] - y1[e];
+			F64 cross = dx * (y - y1[e]) - (x - x1[e]) * dy;
+			if (cross == 0.0)
+			{
+				if ((x1[e] < x2[e] ? (x1[e] <= x && x <= x2[e]) : (x2[e] <= x && x <= x1[e])) &&
+					(y1[e] < y2[e] ? (y1[e] <= y && y <= y2[e]) : (y2[e] <= y && y <= y1[e]))) return FALSE;
+			}
+			if ((y1[e] > y) != (y2[e] > y))
+			{
+				if ((cross > 0.0) == (dy > 0.0)) in = !in;
+			}
+		}
+		return in;
+	};
+
+	//test of a quantized point, rejected by integer comparisons against the
+	//envelope rounded inwards to whole units, only a polygon set up with a
+	//quantizer gives meaningful results
+	inline BOOL inside(const I32 X, const I32 Y) const
+	{
+		if (X < min_X || X > max_X || Y < min_Y || Y > max_Y) return FALSE;
+		return inside((F64)X, (F64)Y);
+	};
+
+	//tests n points at once, mask[i] is set to 1 if (x[i],y[i]) is inside
+	//and to 0 otherwise, with the same results as the single point test
+	void inside(const F64* x, const F64* y, const U32 n, U8* mask) const;
+
+	//name of the block kernel selected for this CPU
+	static const CHAR* get_kernel_name();
+
+	LASpolygon();
+	~LASpolygon();
+
+protected:
+	void add_ring(const F64* x, const F64* y, const U32 npoints);
+
+	BOOL quantized;
+	F64 min_x, min_y, max_x, max_y;
+	I32 min_X, min_Y, max_X, max_Y;
+	vector<F64> edge_x1;
+	vector<F64> edge_y1;
+	vector<F64> edge_x2;
+	vector<F64> edge_y2;
+};
+
+#endif
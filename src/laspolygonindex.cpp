@@ -0,0 +1,160 @@
+/*
+===============================================================================
+
+FILE:  laspolygonindex.cpp
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- created for lasclip single pass clipping
+
+===============================================================================
+*/
+
+#include "laspolygonindex.h"
+#include <math.h>
+
+//upper bound on the number of grid cells, whatever the number of polygons
+#define LAS_POLYGON_INDEX_MAX_CELLS (1 << 24)
+
+LASpolygonIndex::LASpolygonIndex()
+{
+	min_x = min_y = 1.0;
+	max_x = max_y = 0.0;
+	inv_cell_size_x = inv_cell_size_y = 0.0;
+	ncols = nrows = 0;
+}
+
+LASpolygonIndex::~LASpolygonIndex()
+{
+}
+
+void LASpolygonIndex::add(const F64 min_x, const F64 min_y, const F64 max_x, const F64 max_y)
+{
+	envelopes.push_back(min_x);
+	envelopes.push_back(min_y);
+	envelopes.push_back(max_x);
+	envelopes.push_back(max_y);
+}
+
+BOOL LASpolygonIndex::build(const F64 polygons_per_cell)
+{
+	U32 p, npolygons = get_number_of_polygons();
+	cell_start.clear();
+	cell_polygons.clear();
+	if (npolygons == 0)
+	{
+		min_x = min_y = 1.0;
+		max_x = max_y = 0.0;
+		return FALSE;
+	}
+
+	//union of all envelopes, empty (inverted) envelopes are skipped
+	min_x = min_y = 1.7976931348623157e+308;
+	max_x = max_y = -1.7976931348623157e+308;
+	for (p = 0; p < npolygons; p++)
+	{
+		if (get_min_x(p) > get_max_x(p) || get_min_y(p) > get_max_y(p)) continue;
+		if (get_min_x(p) < min_x) min_x = get_min_x(p);
+		if (get_min_y(p) < min_y) min_y = get_min_y(p);
+		if (get_max_x(p) > max_x) max_x = get_max_x(p);
+		if (get_max_y(p) > max_y) max_y = get_max_y(p);
+	}
+
+	if (min_x > max_x)
+	{
+		min_x = min_y = 1.0;
+		max_x = max_y = 0.0;
+		return FALSE;
+	}
+
+	//square cells, about polygons_per_cell envelopes per cell
+	F64 size_x = max_x - min_x;
+	F64 size_y = max_y - min_y;
+	F64 cells = (polygons_per_cell > 0.0 ? npolygons / polygons_per_cell : npolygons);
+	if (cells < 1.0) cells = 1.0;
+	if (cells > LAS_POLYGON_INDEX_MAX_CELLS) cells = LAS_POLYGON_INDEX_MAX_CELLS;
+	F64 cell_size = sqrt((size_x * size_y) / cells);
+	if (cell_size <= 0.0) cell_size = (size_x > size_y ? size_x : size_y) / cells;
+	if (cell_size <= 0.0)
+	{
+		ncols = nrows = 1;
+	}
+	else
+	{
+		ncols = (I32)(size_x / cell_size) + 1;
+		nrows = (I32)(size_y / cell_size) + 1;
+		while ((F64)ncols * (F64)nrows > LAS_POLYGON_INDEX_MAX_CELLS)
+		{
+			ncols = (ncols + 1) / 2;
+			nrows = (nrows + 1) / 2;
+		}
+	}
+	inv_cell_size_x = (size_x > 0.0 ? ncols / size_x : 0.0);
+	inv_cell_size_y = (size_y > 0.0 ? nrows / size_y : 0.0);
+
+	//count, then fill the polygon lists of each cell (compressed row storage)
+	U32 ncells = (U32)ncols * (U32)nrows;
+	cell_start.assign(ncells + 1, 0);
+	I32 col, row, col_min, col_max, row_min, row_max;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (p = 0; p < npolygons; p++)
+		{
+			if (get_min_x(p) > get_max_x(p) || get_min_y(p) > get_max_y(p)) continue;
+			col_min = (I32)((get_min_x(p) - min_x) * inv_cell_size_x); if (col_min >= ncols) col_min = ncols - 1;
+			col_max = (I32)((get_max_x(p) - min_x) * inv_cell_size_x); if (col_max >= ncols) col_max = ncols - 1;
+			row_min = (I32)((get_min_y(p) - min_y) * inv_cell_size_y); if (row_min >= nrows) row_min = nrows - 1;
+			row_max = (I32)((get_max_y(p) - min_y) * inv_cell_size_y); if (row_max >= nrows) row_max = nrows - 1;
+			for (row = row_min; row <= row_max; row++)
+			{
+				for (col = col_min; col <= col_max; col++)
+				{
+					U32 cell = (U32)row * (U32)ncols + (U32)col;
+					if (pass == 0) cell_start[cell + 1]++;
+					else cell_polygons[cell_start[cell]++] = p;
+				}
+			}
+		}
+		if (pass == 0)
+		{
+			for (U32 c = 0; c < ncells; c++) cell_start[c + 1] += cell_start[c];
+			cell_polygons.resize(cell_start[ncells]);
+		}
+		else
+		{
+			//filling advanced each start to the next cell's start, shift back
+			for (U32 c = ncells; c > 0; c--) cell_start[c] = cell_start[c - 1];
+			cell_start[0] = 0;
+		}
+	}
+	return TRUE;
+}
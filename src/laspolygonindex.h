@@ -0,0 +1,99 @@
+/*
+===============================================================================
+
+FILE:  laspolygonindex.h
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+Uniform grid spatial index over the envelopes of a set of polygons. Each
+grid cell lists the polygons whose envelope overlaps it, so that a point
+can be routed to its candidate polygons with a single cell lookup.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- created for lasclip single pass clipping
+
+===============================================================================
+*/
+
+#ifndef LAS_POLYGON_INDEX_H
+#define LAS_POLYGON_INDEX_H
+
+#include "mydefs.hpp"
+#include <vector>
+using namespace std;
+
+class LASpolygonIndex
+{
+public:
+	//polygons are numbered in the order their envelopes are added
+	void add(const F64 min_x, const F64 min_y, const F64 max_x, const F64 max_y);
+	//builds the grid, targeting about polygons_per_cell envelopes per cell
+	BOOL build(const F64 polygons_per_cell = 1.0);
+
+	inline U32 get_number_of_polygons() const { return (U32)(envelopes.size() / 4); };
+	inline F64 get_min_x(const U32 p) const { return envelopes[4 * p]; };
+	inline F64 get_min_y(const U32 p) const { return envelopes[4 * p + 1]; };
+	inline F64 get_max_x(const U32 p) const { return envelopes[4 * p + 2]; };
+	inline F64 get_max_y(const U32 p) const { return envelopes[4 * p + 3]; };
+
+	inline BOOL inside_envelope(const U32 p, const F64 x, const F64 y) const
+	{
+		const F64* e = &envelopes[4 * p];
+		return (e[0] <= x) && (x <= e[2]) && (e[1] <= y) && (y <= e[3]);
+	};
+
+	//returns the number of candidate polygons of the cell containing (x,y) and
+	//sets candidates to their indices, the caller still has to test envelopes
+	inline U32 get_candidates(const F64 x, const F64 y, const U32** candidates) const
+	{
+		if (x < min_x || y < min_y || x > max_x || y > max_y) return 0;
+		I32 col = (I32)((x - min_x) * inv_cell_size_x);
+		I32 row = (I32)((y - min_y) * inv_cell_size_y);
+		if (col >= ncols) col = ncols - 1;
+		if (row >= nrows) row = nrows - 1;
+		U32 cell = (U32)row * (U32)ncols + (U32)col;
+		*candidates = &cell_polygons[0] + cell_start[cell];
+		return cell_start[cell + 1] - cell_start[cell];
+	};
+
+	LASpolygonIndex();
+	~LASpolygonIndex();
+
+protected:
+	vector<F64> envelopes;
+	F64 min_x, min_y, max_x, max_y;
+	F64 inv_cell_size_x, inv_cell_size_y;
+	I32 ncols, nrows;
+	vector<U32> cell_start;
+	vector<U32> cell_polygons;
+};
+
+#endif
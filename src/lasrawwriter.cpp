@@ -0,0 +1,262 @@
+/*
+===============================================================================
+
+FILE:  lasrawwriter.cpp
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- exact size files counted first, then streamed by create() and append()
+17 October 2026 -- the scratch file of make_header_template() removed on every path
+17 October 2026 -- write_file() writes a whole file once, to its final size
+17 October 2026 -- created for lasclip raw record passthrough
+
+===============================================================================
+*/
+
+#include "lasrawwriter.h"
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//offsets of the fields of the public header block patched on close
+#define LAS_RAW_OFFSET_VERSION_MINOR 25
+#define LAS_RAW_OFFSET_OFFSET_TO_POINT_DATA 96
+#define LAS_RAW_OFFSET_NUMBER_OF_POINT_RECORDS 107
+#define LAS_RAW_OFFSET_NUMBER_OF_POINTS_BY_RETURN 111
+#define LAS_RAW_OFFSET_MAX_X 179
+#define LAS_RAW_OFFSET_EXTENDED_NUMBER_OF_POINT_RECORDS 247
+#define LAS_RAW_OFFSET_EXTENDED_NUMBER_OF_POINTS_BY_RETURN 255
+#define LAS_RAW_HEADER_BLOCK_SIZE 375
+
+BOOL LASrawWriter::supports(const LASheader* header, const U32 record_size)
+{
+	if (header->point_data_format > 5) return FALSE;
+	//EVLRs would be written by the LASwriter right where the points go
+	if (header->version_minor >= 4 && header->number_of_extended_variable_length_records) return FALSE;
+	return (header->point_data_record_length == record_size);
+}
+
+LASrawWriter::LASrawWriter()
+{
+	header = 0;
+	file = 0;
+	record_size = 0;
+	offset_to_point_data = 0;
+	npoints = 0;
+	counted = FALSE;
+}
+
+LASrawWriter::~LASrawWriter()
+{
+	if (file) fclose(file);
+}
+
+void LASrawWriter::reset(const LASheader* header)
+{
+	this->header = header;
+	record_size = header->point_data_record_length;
+	npoints = 0;
+	memset(npoints_by_return, 0, sizeof(npoints_by_return));
+	min_X = min_Y = min_Z = I32_MAX;
+	max_X = max_Y = max_Z = I32_MIN;
+	counted = FALSE;
+}
+
+BOOL LASrawWriter::open(LASwriteOpener* laswriteopener, const CHAR* file_name, const LASheader* header)
+{
+	reset(header);
+	laswriteopener->set_file_name(file_name);
+	LASwriter* laswriter = laswriteopener->open(header);
+	laswriteopener->set_file_name(0);
+	if (laswriter == 0) return FALSE;
+	laswriter->close();
+	delete laswriter;
+
+	//the points start where the written header says
+	file = fopen(file_name, "r+b");
+	if (file == 0) return FALSE;
+	if (fseek(file, LAS_RAW_OFFSET_OFFSET_TO_POINT_DATA, SEEK_SET) != 0 || fread(&offset_to_point_data, 4, 1, file) != 1) return FALSE;
+	return (fseek(file, offset_to_point_data, SEEK_SET) == 0);
+}
+
+void LASrawWriter::count(const U8* records, const size_t nrecords)
+{
+	//X, Y and Z lead every record, the return number is in the low 3 bits of
+	//the byte after the intensity in formats 0 to 5
+	const U8* record = records;
+	for (size_t r = 0; r < nrecords; r++, record += record_size)
+	{
+		I32 X, Y, Z;
+		memcpy(&X, record, 4);
+		memcpy(&Y, record + 4, 4);
+		memcpy(&Z, record + 8, 4);
+		if (X < min_X) min_X = X;
+		if (X > max_X) max_X = X;
+		if (Y < min_Y) min_Y = Y;
+		if (Y > max_Y) max_Y = Y;
+		if (Z < min_Z) min_Z = Z;
+		if (Z > max_Z) max_Z = Z;
+		U32 return_number = record[14] & 7;
+		if (return_number > 0) npoints_by_return[return_number - 1]++;
+	}
+	npoints += nrecords;
+}
+
+BOOL LASrawWriter::write_records(const U8* records, const size_t nrecords)
+{
+	if (nrecords == 0) return TRUE;
+	if (fwrite(records, record_size, nrecords, file) != nrecords) return FALSE;
+	count(records, nrecords);
+	return TRUE;
+}
+
+void LASrawWriter::patch(U8* bytes, const size_t size) const
+{
+	U32 r;
+	//legacy counts are 0 when they overflow, as LAS 1.4 asks
+	U32 number_of_point_records = (npoints <= (I64)U32_MAX ? (U32)npoints : 0);
+	U32 number_of_points_by_return[5];
+	for (r = 0; r < 5; r++) number_of_points_by_return[r] = (npoints <= (I64)U32_MAX ? (U32)npoints_by_return[r] : 0);
+	//max x, min x, max y, min y, max z, min z
+	F64 bounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	if (npoints)
+	{
+		bounds[0] = header->get_x(max_X);
+		bounds[1] = header->get_x(min_X);
+		bounds[2] = header->get_y(max_Y);
+		bounds[3] = header->get_y(min_Y);
+		bounds[4] = header->get_z(max_Z);
+		bounds[5] = header->get_z(min_Z);
+	}
+	if (size < LAS_RAW_OFFSET_MAX_X + sizeof(bounds)) return;
+	memcpy(bytes + LAS_RAW_OFFSET_NUMBER_OF_POINT_RECORDS, &number_of_point_records, 4);
+	memcpy(bytes + LAS_RAW_OFFSET_NUMBER_OF_POINTS_BY_RETURN, number_of_points_by_return, 20);
+	memcpy(bytes + LAS_RAW_OFFSET_MAX_X, bounds, sizeof(bounds));
+	if (bytes[LAS_RAW_OFFSET_VERSION_MINOR] >= 4 && size >= LAS_RAW_HEADER_BLOCK_SIZE)
+	{
+		U64 extended_number_of_point_records = (U64)npoints;
+		U64 extended_number_of_points_by_return[15];
+		for (r = 0; r < 15; r++) extended_number_of_points_by_return[r] = (U64)npoints_by_return[r];
+		memcpy(bytes + LAS_RAW_OFFSET_EXTENDED_NUMBER_OF_POINT_RECORDS, &extended_number_of_point_records, 8);
+		memcpy(bytes + LAS_RAW_OFFSET_EXTENDED_NUMBER_OF_POINTS_BY_RETURN, extended_number_of_points_by_return, sizeof(extended_number_of_points_by_return));
+	}
+}
+
+BOOL LASrawWriter::close()
+{
+	if (file == 0) return FALSE;
+	if (counted)
+	{
+		BOOL ok = (fclose(file) == 0);
+		file = 0;
+		return ok;
+	}
+	//the public header block is read back, patched and rewritten at once
+	vector<U8> bytes(offset_to_point_data < LAS_RAW_HEADER_BLOCK_SIZE ? offset_to_point_data : LAS_RAW_HEADER_BLOCK_SIZE);
+	BOOL ok = (bytes.size() > LAS_RAW_OFFSET_VERSION_MINOR);
+	ok = ok && (fseek(file, 0, SEEK_SET) == 0) && (fread(&bytes[0], 1, bytes.size(), file) == bytes.size());
+	if (ok)
+	{
+		patch(&bytes[0], bytes.size());
+		ok = (fseek(file, 0, SEEK_SET) == 0) && (fwrite(&bytes[0], 1, bytes.size(), file) == bytes.size());
+	}
+	if (fclose(file) != 0) ok = FALSE;
+	file = 0;
+	return ok;
+}
+
+BOOL LASrawWriter::make_header_template(LASwriteOpener* laswriteopener, const CHAR* scratch_file_name, const LASheader* header, vector<U8>& header_template)
+{
+	header_template.clear();
+	laswriteopener->set_file_name(scratch_file_name);
+	LASwriter* laswriter = laswriteopener->open(header);
+	laswriteopener->set_file_name(0);
+	if (laswriter == 0)
+	{
+		remove(scratch_file_name);
+		return FALSE;
+	}
+	laswriter->close();
+	delete laswriter;
+
+	FILE* file = fopen(scratch_file_name, "rb");
+	if (file == 0)
+	{
+		remove(scratch_file_name);
+		return FALSE;
+	}
+	U32 offset = 0;
+	BOOL ok = (fseek(file, LAS_RAW_OFFSET_OFFSET_TO_POINT_DATA, SEEK_SET) == 0) && (fread(&offset, 4, 1, file) == 1) && (offset > LAS_RAW_OFFSET_MAX_X);
+	if (ok)
+	{
+		header_template.resize(offset);
+		ok = (fseek(file, 0, SEEK_SET) == 0) && (fread(&header_template[0], 1, offset, file) == offset);
+	}
+	fclose(file);
+	remove(scratch_file_name);
+	if (!ok) header_template.clear();
+	return ok;
+}
+
+BOOL LASrawWriter::create(const CHAR* file_name, const vector<U8>& header_template)
+{
+	if (header_template.empty() || header == 0) return FALSE;
+	vector<U8> bytes(header_template);
+	patch(&bytes[0], bytes.size());
+
+	file = fopen(file_name, "wb");
+	if (file == 0) return FALSE;
+	counted = TRUE;
+	//the final size is reserved up front so that the file grows in one piece
+	I64 size = (I64)bytes.size() + npoints * record_size;
+#ifdef _WIN32
+	HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file));
+	LARGE_INTEGER end, start;
+	end.QuadPart = size;
+	start.QuadPart = 0;
+	if (SetFilePointerEx(handle, end, NULL, FILE_BEGIN) && SetEndOfFile(handle)) SetFilePointerEx(handle, start, NULL, FILE_BEGIN);
+#else
+	posix_fallocate(fileno(file), 0, (off_t)size);
+#endif
+	return (fwrite(&bytes[0], 1, bytes.size(), file) == bytes.size());
+}
+
+BOOL LASrawWriter::append(const U8* records, const size_t nrecords)
+{
+	if (nrecords == 0) return TRUE;
+	return (fwrite(records, record_size, nrecords, file) == nrecords);
+}
@@ -0,0 +1,109 @@
+/*
+===============================================================================
+
+FILE:  lasrawwriter.h
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+Writer of uncompressed LAS files that takes the raw records of points of
+formats 0 to 5, which are laid out on disk as LASpoint::copy_to() lays
+them out in memory. A LASwriter writes the header and the VLRs without
+any point, the records are then appended as they are and the counts and
+bounds of the header are patched from their raw X, Y, Z and return number,
+so that writing a point costs a memcpy instead of an encoding.
+
+A file can also be written at once when all its records are known, from a
+template of the header and VLRs that is patched in memory beforehand, so
+that the file is only appended to, sequentially and to its final size.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- exact size files counted first, then streamed by create() and append()
+17 October 2026 -- write_file() writes a whole file once, to its final size
+17 October 2026 -- created for lasclip raw record passthrough
+
+===============================================================================
+*/
+
+#ifndef LAS_RAW_WRITER_H
+#define LAS_RAW_WRITER_H
+
+#include "laswriter.hpp"
+#include <stdio.h>
+#include <vector>
+using namespace std;
+
+class LASrawWriter
+{
+public:
+	//TRUE when the records of points of header are written as they are, that
+	//is for point formats 0 to 5 without padding after the point
+	static BOOL supports(const LASheader* header, const U32 record_size);
+
+	//laswriteopener, of format las, writes the header and the VLRs
+	BOOL open(LASwriteOpener* laswriteopener, const CHAR* file_name, const LASheader* header);
+	BOOL write_records(const U8* records, const size_t nrecords);
+	//patches the number of points, the numbers of points by return and the
+	//bounds of the header, then closes the file
+	BOOL close();
+	inline I64 get_number_of_points() const { return npoints; };
+
+	//header and VLRs as laswriteopener writes them for a file with no point,
+	//written to scratch_file_name and read back, which is then removed
+	static BOOL make_header_template(LASwriteOpener* laswriteopener, const CHAR* scratch_file_name, const LASheader* header, vector<U8>& header_template);
+	//exact size files are written in one sequential pass. all their records
+	//are counted first, by reset() then count(), create() then writes the
+	//header template patched with their counts and bounds and reserves the
+	//final size, append() writes the counted records as they are, and close()
+	//has nothing left to patch
+	void reset(const LASheader* header);
+	void count(const U8* records, const size_t nrecords);
+	BOOL create(const CHAR* file_name, const vector<U8>& header_template);
+	BOOL append(const U8* records, const size_t nrecords);
+
+	LASrawWriter();
+	~LASrawWriter();
+
+protected:
+	//patches the first size bytes of a file, those of the public header block
+	void patch(U8* bytes, const size_t size) const;
+
+	const LASheader* header;
+	FILE* file;
+	U32 record_size;
+	U32 offset_to_point_data;
+	I64 npoints;
+	I64 npoints_by_return[15];
+	I32 min_X, min_Y, min_Z, max_X, max_Y, max_Z;
+	//the header was written patched by create()
+	BOOL counted;
+};
+
+#endif
@@ -34,6 +34,17 @@ implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
 
 CHANGE HISTORY:
 
+17 October 2026 -- get_file_index() of the points reordered by the cell index
+17 October 2026 -- loading the points returns FALSE instead of throwing when out of memory
+17 October 2026 -- estimate_points_inside() for scheduling queries by cost
+17 October 2026 -- LASrectangleQuery replaces get_points_inside(), also with LAX
+17 October 2026 -- const get_points_inside() for concurrent queries
+17 October 2026 -- points loaded slab by slab on several threads
+17 October 2026 -- points streamed from the file as by LASreaderLAS until loaded
+17 October 2026 -- points of uncompressed LAS files mapped in place by map_allpoints()
+17 October 2026 -- optional Morton ordered cell index for files without LAX
+17 October 2026 -- quantized X, Y and Z also kept in columns for scans
+17 October 2026 -- points held as raw records in slabs instead of LASpoint objects
 21 April 2017 -- created in Benoit St-Onge's Lab at UQAM in Montreal
 
 ===============================================================================
@@ -42,19 +53,60 @@ CHANGE HISTORY:
 
 #include "lasreaderlasram.h"
 #include "lasindex.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <thread>
+#include <new> //for std::bad_alloc
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 LASreaderLASRAM::LASreaderLASRAM()
 {
+	ppoint = &point;
+	record_size = 0;
+	ram_npoints = 0;
+	decoding = TRUE;
+	q_min_x = q_min_y = 1.0;
+	q_max_x = q_max_y = 0.0;
+	r_min_X = r_min_Y = 1;
+	r_max_X = r_max_Y = 0;
+	cell_level = 0;
+	cell_min_X = cell_min_Y = 0;
+	cell_size_X = cell_size_Y = 1;
+	range_cursor = 0;
+	mapped_view = 0;
+	mapped_size = 0;
+	mapped_file = 0;
+	mapped_mapping = 0;
+	load_threads = 0;
 }
 
 LASreaderLASRAM::~LASreaderLASRAM()
 {
-	vector<LASpoint*>::iterator it;
-	for (it = laspointvector.begin(); it != laspointvector.end(); it++)
+	if (mapped_view)
 	{
-		delete (*it);
+		unmap_allpoints();
 	}
-	laspointvector.clear();
+	else
+	{
+		vector<U8*>::iterator it;
+		for (it = slabs.begin(); it != slabs.end(); it++)
+		{
+			free(*it);
+		}
+	}
+	slabs.clear();
+	ram_X.clear();
+	ram_Y.clear();
+	ram_Z.clear();
 }
 
 BOOL LASreaderLASRAM::open(const char* file_name, I32 io_buffer_size, BOOL peek_only)
@@ -64,52 +116,439 @@ BOOL LASreaderLASRAM::open(const char* file_name, I32 io_buffer_size, BOOL peek_
 	if (bresult)
 	{
 		//return read_allpoints();
+		this->file_name = file_name;
 	}
 	return bresult;
 }
 
+BOOL LASreaderLASRAM::has_raw_records() const
+{
+	//compressed points and the extended point formats 6 to 10 differ from
+	//their LASpoint::copy_to() layout
+	if (header.laszip) return FALSE;
+	if ((header.point_data_format & 0x3F) > 5) return FALSE;
+	if (point.total_point_size != header.point_data_record_length) return FALSE;
+	return TRUE;
+}
+
 BOOL LASreaderLASRAM::read_allpoints()
 {
-	if (laspointvector.empty())
+	if (!slabs.empty()) return FALSE;
+	//without a file name the points can only be read through this reader
+	if (file_name.empty() || npoints <= 0) return read_allpoints_sequential();
+
+	//the slabs and columns are allocated up front, the threads fill them
+	record_size = point.total_point_size;
+	U32 nslabs = (U32)((npoints + LAS_RAM_SLAB_POINTS - 1) >> LAS_RAM_SLAB_BITS);
+	try
 	{
-		//read all points in RAM
-		laspointvector.reserve(npoints);
-		seek(0);//seek(6349736);
-		while (LASreaderLAS::read_point_default())
+		slabs.reserve(nslabs);
+		for (U32 s = 0; s < nslabs; s++)
 		{
-			LASpoint* plaspoint = new LASpoint;
-			if (plaspoint)
+			I64 slab_points = npoints - ((I64)s << LAS_RAM_SLAB_BITS);
+			if (slab_points > LAS_RAM_SLAB_POINTS) slab_points = LAS_RAM_SLAB_POINTS;
+			U8* record = (U8*)malloc((size_t)slab_points * record_size);
+			if (record == 0)
 			{
-				// if the point needs to be copied set up the data fields
-				if (plaspoint->init(&header, header.point_data_format, header.point_data_record_length))
-				{
-					*plaspoint = point;
-					laspointvector.push_back(plaspoint);
-				}
-				else
+				fprintf(stderr, "ERROR: allocating slab of %d points failed, not enough memory.\n", (I32)slab_points);
+				for (size_t k = 0; k < slabs.size(); k++) free(slabs[k]);
+				slabs.clear();
+				return FALSE;
+			}
+			slabs.push_back(record);
+		}
+		ram_X.resize((size_t)npoints);
+		ram_Y.resize((size_t)npoints);
+		ram_Z.resize((size_t)npoints);
+	}
+	catch (std::bad_alloc&)
+	{
+		fprintf(stderr, "ERROR: allocating %.0f points failed, not enough memory.\n", (F64)npoints);
+		for (size_t k = 0; k < slabs.size(); k++) free(slabs[k]);
+		vector<U8*>().swap(slabs);
+		vector<I32>().swap(ram_X);
+		vector<I32>().swap(ram_Y);
+		vector<I32>().swap(ram_Z);
+		return FALSE;
+	}
+
+	U32 nthreads = load_threads;
+	if (nthreads == 0) nthreads = std::thread::hardware_concurrency();
+	if (nthreads == 0) nthreads = 1;
+	if (nthreads > nslabs) nthreads = nslabs;
+	std::atomic<U32> next_slab(0);
+	std::atomic<U32> failed(0);
+	vector<std::thread> workers;
+	for (U32 t = 1; t < nthreads; t++)
+	{
+		workers.push_back(std::thread(&LASreaderLASRAM::load_slabs, this, &next_slab, &failed));
+	}
+	load_slabs(&next_slab, &failed);
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+
+	if (failed)
+	{
+		fprintf(stderr, "ERROR: loading the points of '%s' failed.\n", file_name.c_str());
+		for (size_t k = 0; k < slabs.size(); k++) free(slabs[k]);
+		slabs.clear();
+		vector<I32>().swap(ram_X);
+		vector<I32>().swap(ram_Y);
+		vector<I32>().swap(ram_Z);
+		return FALSE;
+	}
+	ram_npoints = npoints;
+	p_count = 0;
+	return TRUE;
+}
+
+void LASreaderLASRAM::load_slabs(std::atomic<U32>* next_slab, std::atomic<U32>* failed)
+{
+	BOOL raw = has_raw_records();
+	FILE* file = 0;
+	LASreaderLAS* lasreaderlas = 0;
+	if (raw)
+	{
+		file = fopen(file_name.c_str(), "rb");
+		if (file == 0)
+		{
+			(*failed)++;
+			return;
+		}
+	}
+	else
+	{
+		lasreaderlas = new LASreaderLAS();
+		if (!lasreaderlas->open(file_name.c_str()))
+		{
+			delete lasreaderlas;
+			(*failed)++;
+			return;
+		}
+	}
+
+	U32 nslabs = (U32)slabs.size();
+	U32 s;
+	while (*failed == 0 && (s = (*next_slab)++) < nslabs)
+	{
+		I64 start = (I64)s << LAS_RAM_SLAB_BITS;
+		I64 count = npoints - start;
+		if (count > LAS_RAM_SLAB_POINTS) count = LAS_RAM_SLAB_POINTS;
+		U8* record = slabs[s];
+		if (raw)
+		{
+			//the records are read in one block and only the columns are decoded
+			I64 offset = (I64)header.offset_to_point_data + start * record_size;
+#ifdef _WIN32
+			BOOL sought = (_fseeki64(file, offset, SEEK_SET) == 0);
+#else
+			BOOL sought = (fseeko(file, (off_t)offset, SEEK_SET) == 0);
+#endif
+			if (!sought || fread(record, record_size, (size_t)count, file) != (size_t)count)
+			{
+				(*failed)++;
+				break;
+			}
+			for (I64 i = start; i < start + count; i++, record += record_size)
+			{
+				memcpy(&ram_X[(size_t)i], record, 4);
+				memcpy(&ram_Y[(size_t)i], record + 4, 4);
+				memcpy(&ram_Z[(size_t)i], record + 8, 4);
+			}
+		}
+		else
+		{
+			if (!lasreaderlas->seek(start))
+			{
+				(*failed)++;
+				break;
+			}
+			for (I64 i = start; i < start + count; i++, record += record_size)
+			{
+				if (!lasreaderlas->read_point())
 				{
-					fprintf(stderr, "ERROR: LASpoint init() failed, not enough memory.\n");
-					return FALSE;
+					(*failed)++;
+					break;
 				}
+				lasreaderlas->point.copy_to(record);
+				ram_X[(size_t)i] = lasreaderlas->point.X;
+				ram_Y[(size_t)i] = lasreaderlas->point.Y;
+				ram_Z[(size_t)i] = lasreaderlas->point.Z;
 			}
-			else
+		}
+	}
+
+	if (file) fclose(file);
+	if (lasreaderlas)
+	{
+		lasreaderlas->close();
+		delete lasreaderlas;
+	}
+}
+
+BOOL LASreaderLASRAM::read_allpoints_sequential()
+{
+	if (slabs.empty())
+	{
+		try
+		{
+			//read all points in RAM, as raw records packed into large slabs
+			record_size = point.total_point_size;
+			slabs.reserve((size_t)((npoints + LAS_RAM_SLAB_POINTS - 1) >> LAS_RAM_SLAB_BITS));
+			ram_X.reserve((size_t)npoints);
+			ram_Y.reserve((size_t)npoints);
+			ram_Z.reserve((size_t)npoints);
+			seek(0);//seek(6349736);
+			U8* record = 0;
+			while (LASreaderLAS::read_point_default())
 			{
-				fprintf(stderr, "ERROR: LASpoint new failed, not enough memory.\n");
-				return FALSE;
+				if ((ram_npoints & LAS_RAM_SLAB_MASK) == 0)
+				{
+					//the last slab is trimmed to the points left to read
+					I64 slab_points = npoints - ram_npoints;
+					if (slab_points > LAS_RAM_SLAB_POINTS || slab_points <= 0) slab_points = LAS_RAM_SLAB_POINTS;
+					record = (U8*)malloc((size_t)slab_points * record_size);
+					if (record == 0)
+					{
+						fprintf(stderr, "ERROR: allocating slab of %d points failed, not enough memory.\n", (I32)slab_points);
+						return FALSE;
+					}
+					slabs.push_back(record);
+				}
+				point.copy_to(record);
+				record += record_size;
+				ram_X.push_back(point.X);
+				ram_Y.push_back(point.Y);
+				ram_Z.push_back(point.Z);
+				ram_npoints++;
+				//do not overrun a last slab trimmed to a wrong point count
+				if (ram_npoints == npoints) break;
 			}
 		}
+		catch (std::bad_alloc&)
+		{
+			fprintf(stderr, "ERROR: allocating %.0f points failed, not enough memory.\n", (F64)npoints);
+			return FALSE;
+		}
 		return TRUE;
 	}
 	return FALSE;
 }
 
+BOOL LASreaderLASRAM::map_allpoints()
+{
+	if (!slabs.empty() || file_name.empty()) return FALSE;
+	if (!has_raw_records()) return FALSE;
+	record_size = point.total_point_size;
+	U64 end_of_points = (U64)header.offset_to_point_data + (U64)npoints * record_size;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return FALSE;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || (U64)file_size.QuadPart < end_of_points)
+	{
+		CloseHandle(file);
+		return FALSE;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		CloseHandle(file);
+		return FALSE;
+	}
+	mapped_view = (U8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (mapped_view == 0)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return FALSE;
+	}
+	mapped_size = (U64)file_size.QuadPart;
+	mapped_file = file;
+	mapped_mapping = mapping;
+#else
+	int fd = ::open(file_name.c_str(), O_RDONLY);
+	if (fd == -1) return FALSE;
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || (U64)file_stat.st_size < end_of_points || file_stat.st_size == 0)
+	{
+		::close(fd);
+		return FALSE;
+	}
+	void* view = mmap(0, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	//the mapping keeps the file referenced
+	::close(fd);
+	if (view == MAP_FAILED) return FALSE;
+	mapped_view = (U8*)view;
+	mapped_size = (U64)file_stat.st_size;
+	//the columns are filled by one sequential pass over the records
+	madvise(mapped_view, (size_t)mapped_size, MADV_SEQUENTIAL);
+#endif
+
+	//the slabs are windows into the view, get_record() works unchanged
+	U8* records = mapped_view + header.offset_to_point_data;
+	try
+	{
+		slabs.reserve((size_t)((npoints + LAS_RAM_SLAB_POINTS - 1) >> LAS_RAM_SLAB_BITS));
+		for (I64 p = 0; p < npoints; p += LAS_RAM_SLAB_POINTS)
+		{
+			slabs.push_back(records + (size_t)p * record_size);
+		}
+		ram_X.resize((size_t)npoints);
+		ram_Y.resize((size_t)npoints);
+		ram_Z.resize((size_t)npoints);
+	}
+	catch (std::bad_alloc&)
+	{
+		fprintf(stderr, "ERROR: allocating the columns of %.0f points failed, not enough memory.\n", (F64)npoints);
+		unmap_allpoints();
+		vector<I32>().swap(ram_X);
+		vector<I32>().swap(ram_Y);
+		vector<I32>().swap(ram_Z);
+		return FALSE;
+	}
+	ram_npoints = npoints;
+	const U8* record = records;
+	for (size_t i = 0; i < (size_t)npoints; i++, record += record_size)
+	{
+		memcpy(&ram_X[i], record, 4);
+		memcpy(&ram_Y[i], record + 4, 4);
+		memcpy(&ram_Z[i], record + 8, 4);
+	}
+
+#ifndef _WIN32
+	//from now on records are only looked up for accepted points
+	madvise(mapped_view, (size_t)mapped_size, MADV_RANDOM);
+#endif
+	return TRUE;
+}
+
+void LASreaderLASRAM::unmap_allpoints()
+{
+#ifdef _WIN32
+	UnmapViewOfFile(mapped_view);
+	CloseHandle((HANDLE)mapped_mapping);
+	CloseHandle((HANDLE)mapped_file);
+#else
+	munmap(mapped_view, (size_t)mapped_size);
+#endif
+	mapped_view = 0;
+	mapped_size = 0;
+	mapped_file = 0;
+	mapped_mapping = 0;
+	slabs.clear();
+	ram_npoints = 0;
+}
+
+//spreads the 16 low bits of v to the even bits of the result
+static inline U32 morton_spread(U32 v)
+{
+	v &= 0x0000FFFF;
+	v = (v | (v << 8)) & 0x00FF00FF;
+	v = (v | (v << 4)) & 0x0F0F0F0F;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+BOOL LASreaderLASRAM::build_cell_index(const U32 points_per_cell)
+{
+	cell_start.clear();
+	cell_origin.clear();
+	range_start.clear();
+	range_end.clear();
+	if (index)
+	{
+		fprintf(stderr, "WARNING: a LAX index is in use, the points are not reordered in a cell index\n");
+		return FALSE;
+	}
+	if (mapped_view)
+	{
+		fprintf(stderr, "WARNING: mapped points are read-only, the points are not reordered in a cell index\n");
+		return FALSE;
+	}
+	if (ram_npoints == 0 || ram_npoints > U32_MAX)
+	{
+		if (ram_npoints) fprintf(stderr, "WARNING: too many points in RAM to build a cell index\n");
+		return FALSE;
+	}
+	U32 n = (U32)ram_npoints;
+	U32 i, j;
+
+	//grid over the bounding box of the quantized coordinates
+	I32 max_X, max_Y;
+	cell_min_X = max_X = ram_X[0];
+	cell_min_Y = max_Y = ram_Y[0];
+	for (i = 1; i < n; i++)
+	{
+		if (ram_X[i] < cell_min_X) cell_min_X = ram_X[i]; else if (ram_X[i] > max_X) max_X = ram_X[i];
+		if (ram_Y[i] < cell_min_Y) cell_min_Y = ram_Y[i]; else if (ram_Y[i] > max_Y) max_Y = ram_Y[i];
+	}
+	cell_level = 0;
+	while (cell_level < LAS_RAM_CELL_MAX_LEVEL && ((U64)points_per_cell << (2 * cell_level)) < (U64)n) cell_level++;
+	U32 ncols = (1u << cell_level);
+	cell_size_X = ((I64)max_X - (I64)cell_min_X) / ncols + 1;
+	cell_size_Y = ((I64)max_Y - (I64)cell_min_Y) / ncols + 1;
+
+	//counting sort on the Morton key of the cell of each point, the array of
+	//keys then turns into the destination of each point
+	U32 ncells = ncols * ncols;
+	vector<U32> dest(n);
+	cell_start.assign(ncells + 1, 0);
+	for (i = 0; i < n; i++)
+	{
+		U32 col = (U32)(((I64)ram_X[i] - cell_min_X) / cell_size_X);
+		U32 row = (U32)(((I64)ram_Y[i] - cell_min_Y) / cell_size_Y);
+		dest[i] = morton_spread(col) | (morton_spread(row) << 1);
+		cell_start[dest[i] + 1]++;
+	}
+	for (i = 0; i < ncells; i++) cell_start[i + 1] += cell_start[i];
+	for (i = 0; i < n; i++) dest[i] = cell_start[dest[i]]++;
+	for (i = ncells; i > 0; i--) cell_start[i] = cell_start[i - 1];
+	cell_start[0] = 0;
+
+	//points then go back to the order of the file through their origin
+	cell_origin.resize(n);
+	for (i = 0; i < n; i++) cell_origin[dest[i]] = i;
+
+	//apply the permutation in place, following its cycles
+	vector<U8> swap_record(record_size);
+	for (i = 0; i < n; i++)
+	{
+		while (dest[i] != i)
+		{
+			j = dest[i];
+			U8* record_i = (U8*)get_record(i);
+			U8* record_j = (U8*)get_record(j);
+			memcpy(&swap_record[0], record_j, record_size);
+			memcpy(record_j, record_i, record_size);
+			memcpy(record_i, &swap_record[0], record_size);
+			std::swap(ram_X[i], ram_X[j]);
+			std::swap(ram_Y[i], ram_Y[j]);
+			std::swap(ram_Z[i], ram_Z[j]);
+			std::swap(dest[i], dest[j]);
+		}
+	}
+
+	//the rectangle, if any, has to be intersected with the new index
+	q_min_x = q_min_y = 1.0;
+	q_max_x = q_max_y = 0.0;
+	return TRUE;
+}
+
 BOOL LASreaderLASRAM::seek(const I64 p_index)
 {
 	//return LASreaderLAS::seek(p_index);
 
+	//until loaded or mapped, the points are streamed from the file
+	if (slabs.empty()) return LASreaderLAS::seek(p_index);
 	if (p_index < npoints)
 	{
 		p_count = p_index;
+		range_cursor = 0;
 		return TRUE;
 	}
 	return FALSE;
@@ -119,10 +558,12 @@ BOOL LASreaderLASRAM::read_point_default()
 {
 	//return LASreaderLAS::read_point_default();
 
-	if (p_count < laspointvector.size())
+	if (slabs.empty()) return LASreaderLAS::read_point_default();
+	if (p_count < ram_npoints)
 	{
 		//point = *(laspointvector[p_count]);
-		ppoint = laspointvector[p_count];
+		if (decoding) point.copy_from(get_record(p_count));
+		ppoint = &point;
 		p_count++;
 		return TRUE;
 	}
@@ -132,20 +573,221 @@ BOOL LASreaderLASRAM::read_point_default()
 	}
 }
 
+//finds the quantized bounds that select exactly the points for which
+//LASpoint::inside_rectangle() holds, that is min <= x < max once unquantized
+static I32 quantize_lower_bound(const LASquantizer* quantizer, const F64 x, const BOOL is_y)
+{
+	F64 scale = (is_y ? quantizer->y_scale_factor : quantizer->x_scale_factor);
+	F64 offset = (is_y ? quantizer->y_offset : quantizer->x_offset);
+	F64 q = floor((x - offset) / scale);
+	if (q < (F64)I32_MIN) return I32_MIN;
+	if (q > (F64)I32_MAX) return I32_MAX;
+	I64 X = (I64)q;
+	//the division may be off by one unit either way, settle on the exact bound
+	while (X > I32_MIN && (is_y ? quantizer->get_y((I32)(X - 1)) : quantizer->get_x((I32)(X - 1))) >= x) X--;
+	while (X < I32_MAX && (is_y ? quantizer->get_y((I32)X) : quantizer->get_x((I32)X)) < x) X++;
+	return (I32)X;
+}
+
+LASrectangleQuery::LASrectangleQuery(const LASreaderLASRAM* reader, const F64 min_x, const F64 min_y, const F64 max_x, const F64 max_y)
+{
+	//min <= x < max turns into min_X <= X <= max_X - 1
+	I32 max_X = quantize_lower_bound(&reader->header, max_x, FALSE);
+	I32 max_Y = quantize_lower_bound(&reader->header, max_y, TRUE);
+	I32 min_X = quantize_lower_bound(&reader->header, min_x, FALSE);
+	I32 min_Y = quantize_lower_bound(&reader->header, min_y, TRUE);
+	if (max_X == I32_MIN || max_Y == I32_MIN) setup(reader, 1, 1, 0, 0);
+	else setup(reader, min_X, min_Y, max_X - 1, max_Y - 1);
+}
+
+LASrectangleQuery::LASrectangleQuery(const LASreaderLASRAM* reader, const I32 min_X, const I32 min_Y, const I32 max_X, const I32 max_Y)
+{
+	setup(reader, min_X, min_Y, max_X, max_Y);
+}
+
+void LASrectangleQuery::setup(const LASreaderLASRAM* reader, const I32 min_X, const I32 min_Y, const I32 max_X, const I32 max_Y)
+{
+	X = reader->get_X_array();
+	Y = reader->get_Y_array();
+	this->min_X = min_X;
+	this->min_Y = min_Y;
+	this->max_X = max_X;
+	this->max_Y = max_Y;
+	reader->get_ranges(min_X, min_Y, max_X, max_Y, starts, ends);
+	range = 0;
+	cursor = 0;
+}
+
+void LASreaderLASRAM::quantize_rectangle()
+{
+	if (q_min_x == r_min_x && q_min_y == r_min_y && q_max_x == r_max_x && q_max_y == r_max_y) return;
+	q_min_x = r_min_x;
+	q_min_y = r_min_y;
+	q_max_x = r_max_x;
+	q_max_y = r_max_y;
+	r_min_X = quantize_lower_bound(&header, r_min_x, FALSE);
+	r_min_Y = quantize_lower_bound(&header, r_min_y, TRUE);
+	r_max_X = quantize_lower_bound(&header, r_max_x, FALSE);
+	r_max_Y = quantize_lower_bound(&header, r_max_y, TRUE);
+	if (!cell_start.empty()) intersect_cell_index();
+}
+
+void LASreaderLASRAM::intersect_cell_index()
+{
+	range_cursor = 0;
+	get_cell_ranges(r_min_X, r_min_Y, r_max_X, r_max_Y, range_start, range_end);
+}
+
+void LASreaderLASRAM::get_cell_ranges(const I64 min_X, const I64 min_Y, const I64 max_X, const I64 max_Y, vector<I64>& starts, vector<I64>& ends) const
+{
+	starts.clear();
+	ends.clear();
+	if (min_X >= max_X || min_Y >= max_Y) return;
+
+	//cells overlapped by the rectangle, whose max bounds are excluded
+	I32 ncols = (1 << cell_level);
+	I64 col_min = (min_X - cell_min_X) / cell_size_X;
+	I64 col_max = (max_X - 1 - cell_min_X) / cell_size_X;
+	I64 row_min = (min_Y - cell_min_Y) / cell_size_Y;
+	I64 row_max = (max_Y - 1 - cell_min_Y) / cell_size_Y;
+	if (max_X - 1 < cell_min_X || max_Y - 1 < cell_min_Y || col_min >= ncols || row_min >= ncols) return;
+	if (min_X < cell_min_X) col_min = 0;
+	if (min_Y < cell_min_Y) row_min = 0;
+	if (col_max >= ncols) col_max = ncols - 1;
+	if (row_max >= ncols) row_max = ncols - 1;
+
+	//cells in Morton order, adjacent point ranges merged into one
+	vector<U32> keys;
+	keys.reserve((size_t)((col_max - col_min + 1) * (row_max - row_min + 1)));
+	for (I64 row = row_min; row <= row_max; row++)
+	{
+		for (I64 col = col_min; col <= col_max; col++)
+		{
+			U32 key = morton_spread((U32)col) | (morton_spread((U32)row) << 1);
+			if (cell_start[key] < cell_start[key + 1]) keys.push_back(key);
+		}
+	}
+	std::sort(keys.begin(), keys.end());
+	for (size_t k = 0; k < keys.size(); k++)
+	{
+		I64 start = cell_start[keys[k]];
+		I64 end = cell_start[keys[k] + 1];
+		if (!ends.empty() && ends.back() == start) ends.back() = end;
+		else
+		{
+			starts.push_back(start);
+			ends.push_back(end);
+		}
+	}
+}
+
+//point ranges that hold all points with min_X <= X <= max_X and min_Y <= Y
+//<= Y, from the cell index, else from the LAX index, else all points
+void LASreaderLASRAM::get_ranges(const I32 min_X, const I32 min_Y, const I32 max_X, const I32 max_Y, vector<I64>& starts, vector<I64>& ends) const
+{
+	starts.clear();
+	ends.clear();
+	if (min_X > max_X || min_Y > max_Y || ram_npoints == 0) return;
+	if (!cell_start.empty())
+	{
+		get_cell_ranges(min_X, min_Y, (I64)max_X + 1, (I64)max_Y + 1, starts, ends);
+	}
+	else if (index)
+	{
+		//the rectangle is widened by one unit, the exact test is on the columns
+		std::lock_guard<std::mutex> lock(index_mutex);
+		if (index->intersect_rectangle(header.get_x(min_X), header.get_y(min_Y), header.get_x((I32)(max_X < I32_MAX ? max_X + 1 : max_X)), header.get_y((I32)(max_Y < I32_MAX ? max_Y + 1 : max_Y))))
+		{
+			while (index->has_intervals())
+			{
+				//the end of a LAX interval is included
+				starts.push_back(index->start);
+				ends.push_back((I64)index->end + 1 < ram_npoints ? (I64)index->end + 1 : ram_npoints);
+			}
+		}
+	}
+	else
+	{
+		starts.push_back(0);
+		ends.push_back(ram_npoints);
+	}
+}
+
+I64 LASreaderLASRAM::estimate_points_inside(const I32 min_X, const I32 min_Y, const I32 max_X, const I32 max_Y) const
+{
+	if (min_X > max_X || min_Y > max_Y || ram_npoints == 0) return 0;
+	if (!cell_start.empty() || index)
+	{
+		vector<I64> starts;
+		vector<I64> ends;
+		get_ranges(min_X, min_Y, max_X, max_Y, starts, ends);
+		I64 npoints = 0;
+		for (size_t r = 0; r < starts.size(); r++) npoints += ends[r] - starts[r];
+		return npoints;
+	}
+	//uniform density over the bounding box of the header
+	F64 bb_min_X = (header.min_x - header.x_offset) / header.x_scale_factor;
+	F64 bb_max_X = (header.max_x - header.x_offset) / header.x_scale_factor;
+	F64 bb_min_Y = (header.min_y - header.y_offset) / header.y_scale_factor;
+	F64 bb_max_Y = (header.max_y - header.y_offset) / header.y_scale_factor;
+	F64 size_X = (max_X < bb_max_X ? max_X : bb_max_X) - (min_X > bb_min_X ? min_X : bb_min_X);
+	F64 size_Y = (max_Y < bb_max_Y ? max_Y : bb_max_Y) - (min_Y > bb_min_Y ? min_Y : bb_min_Y);
+	if (size_X < 0.0 || size_Y < 0.0) return 0;
+	F64 area = (bb_max_X - bb_min_X) * (bb_max_Y - bb_min_Y);
+	if (area <= 0.0) return ram_npoints;
+	F64 npoints = ram_npoints * ((size_X + 1.0) * (size_Y + 1.0) / area);
+	return (npoints < (F64)ram_npoints ? (I64)npoints : ram_npoints);
+}
+
+I64 LASreaderLASRAM::visit_inside_rectangle(const F64 min_x, const F64 min_y, const F64 max_x, const F64 max_y, LASpointVisitor visitor, void* data) const
+{
+	LASrectangleQuery query(this, min_x, min_y, max_x, max_y);
+	I64 p_index, nvisited = 0;
+	while (query.next(&p_index))
+	{
+		nvisited++;
+		if (!visitor(this, p_index, data)) break;
+	}
+	return nvisited;
+}
+
 BOOL LASreaderLASRAM::read_point_inside_rectangle()
 {
-	while (read_point_default())
+	if (slabs.empty()) return LASreaderLAS::read_point_inside_rectangle();
+	//only the X and Y columns are scanned, a record is decoded once it is a hit
+	quantize_rectangle();
+	if (!cell_start.empty())
 	{
-		if (ppoint->inside_rectangle(r_min_x, r_min_y, r_max_x, r_max_y)) return TRUE;
+		//only the point ranges of the cells overlapping the rectangle
+		while (range_cursor < range_start.size())
+		{
+			if (p_count < range_start[range_cursor]) p_count = range_start[range_cursor];
+			while (p_count < range_end[range_cursor])
+			{
+				if (inside_quantized_rectangle(p_count)) return read_point_default();
+				p_count++;
+			}
+			range_cursor++;
+		}
+		return FALSE;
+	}
+	while (p_count < ram_npoints)
+	{
+		if (inside_quantized_rectangle(p_count)) return read_point_default();
+		p_count++;
 	}
 	return FALSE;
 }
 
 BOOL LASreaderLASRAM::read_point_inside_rectangle_indexed()
 {
+	if (slabs.empty()) return LASreaderLAS::read_point_inside_rectangle_indexed();
+	quantize_rectangle();
 	while (index->seek_next((LASreader*)this))
 	{
-		if (read_point_default() && ppoint->inside_rectangle(r_min_x, r_min_y, r_max_x, r_max_y)) return TRUE;
+		if (p_count >= ram_npoints) continue;
+		if (inside_quantized_rectangle(p_count)) return read_point_default();
+		p_count++;
 	}
 	return FALSE;
 }
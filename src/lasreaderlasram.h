@@ -34,6 +34,17 @@ implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
 
 CHANGE HISTORY:
 
+17 October 2026 -- get_file_index() of the points reordered by the cell index
+17 October 2026 -- loading the points returns FALSE instead of throwing when out of memory
+17 October 2026 -- estimate_points_inside() for scheduling queries by cost
+17 October 2026 -- LASrectangleQuery replaces get_points_inside(), also with LAX
+17 October 2026 -- const get_points_inside() for concurrent queries
+17 October 2026 -- points loaded slab by slab on several threads
+17 October 2026 -- points streamed from the file as by LASreaderLAS until loaded
+17 October 2026 -- points of uncompressed LAS files mapped in place by map_allpoints()
+17 October 2026 -- optional Morton ordered cell index for files without LAX
+17 October 2026 -- quantized X, Y and Z also kept in columns for scans
+17 October 2026 -- points held as raw records in slabs instead of LASpoint objects
 21 April 2017 -- created in Benoit St-Onge's Lab at UQAM in Montreal
 
 ===============================================================================
@@ -44,18 +55,160 @@ CHANGE HISTORY:
 
 #include "lasreader_las.hpp"
 #include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+
+//the points are stored in slabs of 2^LAS_RAM_SLAB_BITS raw records
+#define LAS_RAM_SLAB_BITS 20
+#define LAS_RAM_SLAB_POINTS (1 << LAS_RAM_SLAB_BITS)
+#define LAS_RAM_SLAB_MASK (LAS_RAM_SLAB_POINTS - 1)
+
+//the cell index is a 2^level by 2^level grid, with level at most 11
+#define LAS_RAM_CELL_MAX_LEVEL 11
+
+class LASreaderLASRAM;
+
+//called for each point of a query with its index in the reader, returning
+//FALSE stops the query
+typedef BOOL (*LASpointVisitor)(const LASreaderLASRAM* reader, const I64 p_index, void* data);
+
+//cursor over the loaded points of a LASreaderLASRAM inside a rectangle. it
+//holds its own state, so that several threads can query the same reader at
+//once, whether the reader has a LAX index, a cell index or none.
+class LASrectangleQuery
+{
+public:
+	//rectangle in coordinates, min bounds included and max bounds excluded as
+	//by LASreader::inside_rectangle()
+	LASrectangleQuery(const LASreaderLASRAM* reader, const F64 min_x, const F64 min_y, const F64 max_x, const F64 max_y);
+	//rectangle in quantized coordinates, all bounds included
+	LASrectangleQuery(const LASreaderLASRAM* reader, const I32 min_X, const I32 min_Y, const I32 max_X, const I32 max_Y);
+
+	//sets p_index to the next point inside, FALSE once all were visited
+	inline BOOL next(I64* p_index)
+	{
+		while (range < starts.size())
+		{
+			if (cursor < starts[range]) cursor = starts[range];
+			while (cursor < ends[range])
+			{
+				I64 i = cursor++;
+				if (X[i] < min_X || X[i] > max_X || Y[i] < min_Y || Y[i] > max_Y) continue;
+				*p_index = i;
+				return TRUE;
+			}
+			range++;
+		}
+		return FALSE;
+	};
+	//restarts the query from its first point
+	inline void reset() { range = 0; cursor = 0; };
+
+protected:
+	void setup(const LASreaderLASRAM* reader, const I32 min_X, const I32 min_Y, const I32 max_X, const I32 max_Y);
+	const I32* X;
+	const I32* Y;
+	I32 min_X, min_Y, max_X, max_Y;
+	vector<I64> starts;
+	vector<I64> ends;
+	size_t range;
+	I64 cursor;
+};
 
 //class LASreaderLASRAM : public virtual LASreaderLAS
 class LASreaderLASRAM : public LASreaderLAS
 {
+	friend class LASrectangleQuery;
+
 public:
+	//points to the reader's point, decoded from its raw record on each read
 	LASpoint* ppoint;
 protected:
-	vector<LASpoint*> laspointvector;
+	vector<U8*> slabs;
+	U32 record_size;
+	I64 ram_npoints;
+	//quantized coordinates, one dense column each, so that scans over the
+	//points only stream 4 bytes per coordinate instead of whole records
+	vector<I32> ram_X;
+	vector<I32> ram_Y;
+	vector<I32> ram_Z;
+	//when FALSE, reading a point only advances p_count and leaves it undecoded
+	BOOL decoding;
+	//rectangle of the last query in quantized coordinates, max bounds excluded
+	F64 q_min_x, q_min_y, q_max_x, q_max_y;
+	I32 r_min_X, r_min_Y, r_max_X, r_max_Y;
+	//optional cell index, the points are reordered cell by cell along a Morton
+	//curve so that the points of a cell are one contiguous range
+	U32 cell_level;
+	I32 cell_min_X, cell_min_Y;
+	I64 cell_size_X, cell_size_Y;
+	vector<U32> cell_start;
+	//index in the file of each reordered point
+	vector<U32> cell_origin;
+	//merged point ranges of the cells overlapping the rectangle of the query
+	vector<I64> range_start;
+	vector<I64> range_end;
+	size_t range_cursor;
+	//LASindex keeps the intervals of a query inside, queries take turns on it
+	mutable std::mutex index_mutex;
+	//file mapping of map_allpoints(), the slabs then point into the view
+	std::string file_name;
+	U8* mapped_view;
+	U64 mapped_size;
+	void* mapped_file;
+	void* mapped_mapping;
+	//number of threads loading the slabs, 0 for one per hardware thread
+	U32 load_threads;
 
 public:
 	virtual BOOL open(const char* file_name, I32 io_buffer_size, BOOL peek_only);
+	//loads the points slab by slab on several threads, each one reading the
+	//file through its own stream. raw records of uncompressed point formats 0
+	//to 5 are read as they are, other points are decoded by a LASreaderLAS
+	//per thread, that seeks compressed files by their LASzip chunk table.
+	//returns FALSE when the points do not fit in memory.
 	virtual BOOL read_allpoints();
+	inline void set_load_threads(const U32 load_threads) { this->load_threads = load_threads; };
+	//maps the file instead of copying its points, the raw records of point
+	//formats 0 to 5 are laid out as LASpoint::copy_to() does. returns FALSE
+	//for compressed files and other formats, read_allpoints() is then needed.
+	BOOL map_allpoints();
+	inline BOOL is_mapped() const { return (mapped_view != 0); };
+	//until then, the reader streams the points from the file as LASreaderLAS
+	inline BOOL is_loaded() const { return !slabs.empty(); };
+	//reorders the points in RAM cell by cell and builds the cell index used by
+	//rectangle queries, meant for files without LAX, which it would invalidate
+	BOOL build_cell_index(const U32 points_per_cell = 256);
+	inline BOOL has_cell_index() const { return !cell_start.empty(); };
+	//index in the file of a point, which the cell index may have moved
+	inline I64 get_file_index(const I64 p_index) const { return (cell_origin.empty() ? p_index : (I64)cell_origin[(size_t)p_index]); };
+	//calls visitor for each loaded point inside the rectangle, in coordinates
+	//with max bounds excluded, without changing the state of the reader. it
+	//may be called by several threads at once, but not together with the
+	//seek() and read_point() cursor. returns the number of points visited.
+	I64 visit_inside_rectangle(const F64 min_x, const F64 min_y, const F64 max_x, const F64 max_y, LASpointVisitor visitor, void* data) const;
+	//estimated number of points inside a rectangle in quantized coordinates,
+	//all bounds included. with a cell index or a LAX, the number of points of
+	//the ranges a query would scan, otherwise the points in proportion to the
+	//area of the rectangle within the bounding box of the header.
+	I64 estimate_points_inside(const I32 min_X, const I32 min_Y, const I32 max_X, const I32 max_Y) const;
+	inline I64 get_ram_npoints() const { return ram_npoints; };
+	//raw record of a point, as laid out by LASpoint::copy_to()
+	inline const U8* get_record(const I64 p_index) const
+	{
+		return slabs[(size_t)(p_index >> LAS_RAM_SLAB_BITS)] + (size_t)(p_index & LAS_RAM_SLAB_MASK) * record_size;
+	};
+	inline I32 get_X(const I64 p_index) const { return ram_X[(size_t)p_index]; };
+	inline I32 get_Y(const I64 p_index) const { return ram_Y[(size_t)p_index]; };
+	inline I32 get_Z(const I64 p_index) const { return ram_Z[(size_t)p_index]; };
+	inline const I32* get_X_array() const { return (ram_X.empty() ? 0 : &ram_X[0]); };
+	inline const I32* get_Y_array() const { return (ram_Y.empty() ? 0 : &ram_Y[0]); };
+	inline const I32* get_Z_array() const { return (ram_Z.empty() ? 0 : &ram_Z[0]); };
+	//with decoding off, callers look points up by index (p_count - 1 after a
+	//read) through the columns and get_record(), ppoint is then left stale
+	inline void set_decoding(const BOOL decoding) { this->decoding = decoding; };
+	inline BOOL get_decoding() const { return decoding; };
 	LASreaderLASRAM();
 	virtual ~LASreaderLASRAM(); //virtual ~LASreaderLASRAM();
 	virtual BOOL seek(const I64 p_index);
@@ -64,6 +217,22 @@ protected:
 	virtual BOOL read_point_default();
 	virtual BOOL read_point_inside_rectangle();
 	virtual BOOL read_point_inside_rectangle_indexed();
+	void quantize_rectangle();
+	void intersect_cell_index();
+	void get_cell_ranges(const I64 min_X, const I64 min_Y, const I64 max_X, const I64 max_Y, vector<I64>& starts, vector<I64>& ends) const;
+	void get_ranges(const I32 min_X, const I32 min_Y, const I32 max_X, const I32 max_Y, vector<I64>& starts, vector<I64>& ends) const;
+	void unmap_allpoints();
+	BOOL read_allpoints_sequential();
+	void load_slabs(std::atomic<U32>* next_slab, std::atomic<U32>* failed);
+	BOOL has_raw_records() const;
+	inline BOOL inside_quantized_rectangle(const I64 p_index) const
+	{
+		I32 X = ram_X[(size_t)p_index];
+		if (X < r_min_X || X >= r_max_X) return FALSE;
+		I32 Y = ram_Y[(size_t)p_index];
+		if (Y < r_min_Y || Y >= r_max_Y) return FALSE;
+		return TRUE;
+	};
 
 };
 
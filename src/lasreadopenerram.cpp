@@ -34,6 +34,8 @@ implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
 
 CHANGE HISTORY:
 
+17 October 2026 -- LAX index built with the default maximum intervals of lasindex.exe
+17 October 2026 -- LAX index built in-process when missing, optionally cached
 21 April 2017 -- created in Benoit St-Onge's Lab at UQAM in Montreal
 
 ===============================================================================
@@ -44,6 +46,7 @@ CHANGE HISTORY:
 #include "lasreader.hpp"
 
 #include "lasindex.hpp"
+#include "lasquadtree.hpp"
 #include "lasfilter.hpp"
 #include "lastransform.hpp"
 
@@ -60,6 +63,103 @@ CHANGE HISTORY:
 #include "lasreaderpipeon.hpp"
 
 #include "lasreaderlasram.h"
+#include <string>
+
+//the defaults of LAStools' lasindex.exe
+#define LAS_RAM_INDEX_TILE_SIZE 5.0f
+#define LAS_RAM_INDEX_THRESHOLD 1000
+#define LAS_RAM_INDEX_MINIMUM_POINTS 100000
+#define LAS_RAM_INDEX_MAXIMUM_INTERVALS -20
+
+LASreadOpenerRAM::LASreadOpenerRAM()
+{
+	auto_index = FALSE;
+	write_index = FALSE;
+	index_directory = 0;
+}
+
+LASreadOpenerRAM::~LASreadOpenerRAM()
+{
+	if (index_directory) free(index_directory);
+}
+
+void LASreadOpenerRAM::set_auto_index(const BOOL auto_index)
+{
+	this->auto_index = auto_index;
+}
+
+void LASreadOpenerRAM::set_write_index(const BOOL write_index)
+{
+	this->write_index = write_index;
+}
+
+void LASreadOpenerRAM::set_index_directory(const CHAR* index_directory)
+{
+	if (this->index_directory) free(this->index_directory);
+	this->index_directory = (index_directory ? strdup(index_directory) : 0);
+}
+
+//reads the LAX file beside the LAS file, else the one in the index directory,
+//else builds the index when auto_index is set. returns 0 without index.
+LASindex* LASreadOpenerRAM::get_index(const CHAR* file_name)
+{
+	LASindex* index = new LASindex();
+	if (index->read(file_name)) return index;
+
+	//LASindex derives the LAX file name from the LAS file name, so the index
+	//directory is used by naming the LAS file as if it were located there
+	std::string cached_file_name;
+	if (index_directory)
+	{
+		const CHAR* file_name_only = file_name + strlen(file_name);
+		while (file_name_only > file_name && file_name_only[-1] != '\\' && file_name_only[-1] != '/' && file_name_only[-1] != ':') file_name_only--;
+		cached_file_name = std::string(index_directory) + "\\" + file_name_only;
+		if (index->read(cached_file_name.c_str())) return index;
+	}
+	delete index;
+
+	if (!auto_index) return 0;
+	index = build_index(file_name);
+	if (index && (write_index || index_directory))
+	{
+		const CHAR* lax_file_name = (index_directory ? cached_file_name.c_str() : file_name);
+		if (!index->write(lax_file_name))
+		{
+			fprintf(stderr, "WARNING: cannot write LAX file for '%s'\n", lax_file_name);
+		}
+	}
+	return index;
+}
+
+//same as LAStools' lasindex.exe with its default settings, the points are
+//read once by a plain LASreaderLAS
+LASindex* LASreadOpenerRAM::build_index(const CHAR* file_name)
+{
+	LASreaderLAS lasreaderlas;
+	if (!lasreaderlas.open(file_name))
+	{
+		fprintf(stderr, "WARNING: cannot open '%s' to build its LAX index\n", file_name);
+		return 0;
+	}
+	if (lasreaderlas.npoints > U32_MAX)
+	{
+		fprintf(stderr, "WARNING: too many points in '%s' to build its LAX index\n", file_name);
+		lasreaderlas.close();
+		return 0;
+	}
+	LASquadtree* lasquadtree = new LASquadtree;
+	lasquadtree->setup(lasreaderlas.header.min_x, lasreaderlas.header.max_x, lasreaderlas.header.min_y, lasreaderlas.header.max_y, LAS_RAM_INDEX_TILE_SIZE);
+	//the index owns the quadtree from now on
+	LASindex* index = new LASindex();
+	index->prepare(lasquadtree, LAS_RAM_INDEX_THRESHOLD);
+	while (lasreaderlas.read_point())
+	{
+		index->add(lasreaderlas.point.get_x(), lasreaderlas.point.get_y(), (U32)(lasreaderlas.p_count - 1));
+	}
+	index->complete(LAS_RAM_INDEX_MINIMUM_POINTS, LAS_RAM_INDEX_MAXIMUM_INTERVALS);
+	lasreaderlas.close();
+	return index;
+}
 
 //this function should be an integral copy of the base class open member function, 
 //LASreadOpener::open(const CHAR* other_file_name, BOOL reset_after_other),
@@ -235,11 +335,9 @@ LASreader* LASreadOpenerRAM::open(const CHAR* other_file_name, BOOL reset_after_
 					delete lasreaderlas;
 					return 0;
 				}
-				LASindex* index = new LASindex();
-				if (index->read(file_name))
+				LASindex* index = get_index(file_name);
+				if (index)
 					lasreaderlas->set_index(index);
-				else
-					delete index;
 				if (files_are_flightlines)
 				{
 					lasreaderlas->header.file_source_ID = file_name_current;
@@ -34,6 +34,7 @@ implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
 
 CHANGE HISTORY:
 
+17 October 2026 -- LAX index built in-process when missing, optionally cached
 21 April 2017 -- created in Benoit St-Onge's Lab at UQAM in Montreal
 
 ===============================================================================
@@ -44,10 +45,27 @@ CHANGE HISTORY:
 
 #include "lasreader.hpp"
 
+class LASindex;
+
 class LASreadOpenerRAM : public LASreadOpener
 {
 public:
 	LASreader* open(const CHAR* other_file_name = 0, BOOL reset_after_other = TRUE);
+	//when no LAX file is found beside a LAS file (nor in the index directory),
+	//its spatial index is built in-process with LASindex and, if asked, written
+	//beside the LAS file or into the index directory for the next runs
+	void set_auto_index(const BOOL auto_index);
+	void set_write_index(const BOOL write_index);
+	void set_index_directory(const CHAR* index_directory);
+	LASreadOpenerRAM();
+	~LASreadOpenerRAM();
+
+protected:
+	LASindex* get_index(const CHAR* file_name);
+	LASindex* build_index(const CHAR* file_name);
+	BOOL auto_index;
+	BOOL write_index;
+	CHAR* index_directory;
 };
 
 #endif
@@ -0,0 +1,139 @@
+/*
+===============================================================================
+
+FILE:  lastaskscheduler.cpp
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- thieves take the heaviest task left, not the lightest
+17 October 2026 -- created for lasclip multithreaded clipping
+
+===============================================================================
+*/
+
+#include "lastaskscheduler.h"
+#include <algorithm>
+
+struct LAStaskHeavier
+{
+	const vector<I64>* costs;
+	bool operator()(const U32 a, const U32 b) const
+	{
+		//ties keep the order of the tasks
+		if ((*costs)[a] != (*costs)[b]) return (*costs)[a] > (*costs)[b];
+		return a < b;
+	}
+};
+
+LAStaskScheduler::LAStaskScheduler() : steals(0)
+{
+}
+
+LAStaskScheduler::~LAStaskScheduler()
+{
+	for (size_t q = 0; q < queues.size(); q++) delete queues[q];
+}
+
+void LAStaskScheduler::setup(const vector<I64>& costs, const U32 nworkers)
+{
+	U32 t, w, ntasks = (U32)costs.size();
+	for (size_t q = 0; q < queues.size(); q++) delete queues[q];
+	queues.clear();
+	this->costs = costs;
+	steals = 0;
+	for (w = 0; w < (nworkers ? nworkers : 1); w++)
+	{
+		queues.push_back(new LAStaskQueue);
+		queues[w]->cost = 0;
+	}
+
+	//longest processing time first, each task to the least loaded queue
+	vector<U32> order(ntasks);
+	for (t = 0; t < ntasks; t++) order[t] = t;
+	LAStaskHeavier heavier;
+	heavier.costs = &this->costs;
+	std::sort(order.begin(), order.end(), heavier);
+	vector<I64> load(queues.size(), 0);
+	for (t = 0; t < ntasks; t++)
+	{
+		U32 lightest = 0;
+		for (w = 1; w < (U32)queues.size(); w++)
+		{
+			if (load[w] < load[lightest]) lightest = w;
+		}
+		//a task costs at least one, so that free tasks are dealt round robin
+		load[lightest] += (this->costs[order[t]] > 0 ? this->costs[order[t]] : 1);
+		queues[lightest]->tasks.push_back(order[t]);
+	}
+	for (w = 0; w < (U32)queues.size(); w++) queues[w]->cost = load[w];
+}
+
+BOOL LAStaskScheduler::take(const U32 queue, U32* task)
+{
+	LAStaskQueue* q = queues[queue];
+	std::lock_guard<std::mutex> lock(q->mutex);
+	if (q->tasks.empty()) return FALSE;
+	*task = q->tasks.front();
+	q->tasks.pop_front();
+	q->cost -= (costs[*task] > 0 ? costs[*task] : 1);
+	return TRUE;
+}
+
+BOOL LAStaskScheduler::next(const U32 worker, U32* task)
+{
+	U32 nqueues = (U32)queues.size();
+	if (take(worker % nqueues, task)) return TRUE;
+	while (true)
+	{
+		//victim with the most cost left, the costs may change meanwhile and
+		//the steal is simply retried
+		U32 victim = nqueues;
+		I64 most = 0;
+		for (U32 w = 0; w < nqueues; w++)
+		{
+			I64 cost = queues[w]->cost;
+			if (cost > most)
+			{
+				most = cost;
+				victim = w;
+			}
+		}
+		if (victim == nqueues) return FALSE;
+		//the heaviest task left, a light one would leave the heavy ones to
+		//the victim alone
+		if (take(victim, task))
+		{
+			steals++;
+			return TRUE;
+		}
+	}
+}
@@ -0,0 +1,93 @@
+/*
+===============================================================================
+
+FILE:  lastaskscheduler.h
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+Work-stealing scheduler for tasks of known estimated cost. The tasks are
+dealt heaviest first to one queue per worker, each to the queue with the
+least cost so far, and the workers take the tasks of their own queue in
+that order. A worker whose queue runs dry steals the heaviest task of the
+queue that has the most cost left, so that all workers finish at about the
+same time.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- thieves take the heaviest task left, not the lightest
+17 October 2026 -- created for lasclip multithreaded clipping
+
+===============================================================================
+*/
+
+#ifndef LAS_TASK_SCHEDULER_H
+#define LAS_TASK_SCHEDULER_H
+
+#include "mydefs.hpp"
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+using namespace std;
+
+class LAStaskScheduler
+{
+public:
+	//tasks are numbered 0 to costs.size() - 1, costs only need to be relative
+	void setup(const vector<I64>& costs, const U32 nworkers);
+	//sets task to the heaviest task left in the queue of the worker or, once
+	//it is empty, to the heaviest task of the queue with the most cost left,
+	//so that the tasks left over at the end are the light ones. returns FALSE
+	//when no task is left. may be called by all workers at once.
+	BOOL next(const U32 worker, U32* task);
+
+	inline U32 get_number_of_tasks() const { return (U32)costs.size(); };
+	inline U32 get_number_of_workers() const { return (U32)queues.size(); };
+	inline U32 get_number_of_steals() const { return steals; };
+
+	LAStaskScheduler();
+	~LAStaskScheduler();
+
+protected:
+	//takes the heaviest task of the queue, the queues being sorted
+	BOOL take(const U32 queue, U32* task);
+	struct LAStaskQueue
+	{
+		std::mutex mutex;
+		std::deque<U32> tasks;
+		//read without the lock by thieves choosing a queue
+		std::atomic<I64> cost;
+	};
+	vector<LAStaskQueue*> queues;
+	vector<I64> costs;
+	std::atomic<U32> steals;
+};
+
+#endif
@@ -0,0 +1,590 @@
+/*
+===============================================================================
+
+FILE:  laswritebehind.cpp
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- container outputs deferred, their runs appended from the spill file once closed
+17 October 2026 -- deferred outputs on request, get_buffered_size() and hand_over()
+17 October 2026 -- deferred outputs spill their full buffers to the scratch directory
+17 October 2026 -- exact size mode, outputs written once with their final header
+17 October 2026 -- raw records of LAS outputs written as they are by LASrawWriter
+17 October 2026 -- file extensions follow the format, for LAZ outputs
+17 October 2026 -- container mode, all outputs in one file along with a table
+17 October 2026 -- created for lasclip per polygon outputs
+
+===============================================================================
+*/
+
+#include "laswritebehind.h"
+#include "lasappsutility.h" //for LAS_PATH_SEPARATOR
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+//spill files grow past 2 GB
+static int fseek64(FILE* file, const I64 offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, offset, SEEK_SET);
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+LASwriteBehind::LASwriteBehind() : next_thread(0), failed(0)
+{
+	header = 0;
+	record_size = 0;
+	buffer_size = 0;
+	max_inflight = 0;
+	inflight = 0;
+	pending = 0;
+	container = FALSE;
+	container_writer = 0;
+	container_rawwriter = 0;
+	container_failed = FALSE;
+	raw = FALSE;
+	exact = FALSE;
+}
+
+LASwriteBehind::~LASwriteBehind()
+{
+	if (container) close_container();
+	stop();
+	remove_spill_files();
+}
+
+void LASwriteBehind::stop()
+{
+	flush();
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		{
+			std::lock_guard<std::mutex> lock(threads[t]->mutex);
+			threads[t]->stopping = TRUE;
+		}
+		threads[t]->ready.notify_one();
+	}
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		threads[t]->thread.join();
+		delete threads[t];
+	}
+	threads.clear();
+}
+
+BOOL LASwriteBehind::setup(const LASheader* header, const CHAR* format, const U32 nthreads, const U32 buffer_size, const I64 max_inflight)
+{
+	if (container) close_container();
+	stop();
+	remove_spill_files();
+	scratch_directory.clear();
+	this->header = header;
+	this->format = format;
+	this->buffer_size = (buffer_size ? buffer_size : 1);
+	this->max_inflight = max_inflight;
+	failed = 0;
+	next_thread = 0;
+	//records are laid out as by LASpoint::copy_to()
+	LASpoint layout;
+	if (!layout.init(header, header->point_data_format, header->point_data_record_length)) return FALSE;
+	record_size = layout.total_point_size;
+	raw = (this->format == "las" && LASrawWriter::supports(header, record_size));
+	exact = FALSE;
+	header_template.clear();
+	//all queues exist before the first I/O thread looks its own up
+	U32 t;
+	for (t = 0; t < nthreads; t++)
+	{
+		threads.push_back(new LASioThread);
+		threads[t]->stopping = FALSE;
+	}
+	for (t = 0; t < nthreads; t++) threads[t]->thread = std::thread(&LASwriteBehind::run, this, t);
+	return TRUE;
+}
+
+BOOL LASwriteBehind::set_container(const CHAR* file_name, const CHAR* table_file_name)
+{
+	if (header == 0 || container) return FALSE;
+	container = TRUE;
+	container_file_name = file_name;
+	this->table_file_name = table_file_name;
+	container_writer = 0;
+	container_rawwriter = 0;
+	container_failed = FALSE;
+	table.clear();
+	return TRUE;
+}
+
+BOOL LASwriteBehind::set_exact_size(const CHAR* scratch_file_name)
+{
+	if (header == 0 || !raw || container) return FALSE;
+	LASwriteOpener laswriteopener;
+	laswriteopener.set_format(format.c_str());
+	if (!LASrawWriter::make_header_template(&laswriteopener, scratch_file_name, header, header_template)) return FALSE;
+	exact = TRUE;
+	return TRUE;
+}
+
+void LASwriteBehind::set_scratch_directory(const CHAR* scratch_directory)
+{
+	remove_spill_files();
+	this->scratch_directory = (scratch_directory ? scratch_directory : "");
+	if (this->scratch_directory.empty()) return;
+	size_t nspills = (threads.size() ? threads.size() : 1);
+	for (size_t s = 0; s < nspills; s++)
+	{
+		char spillnumber[32];
+		sprintf(spillnumber, "spill_%u.tmp", (U32)s);
+		LASspillFile* spillfile = new LASspillFile;
+		spillfile->file_name = this->scratch_directory + LAS_PATH_SEPARATOR + spillnumber;
+		spillfile->file = 0;
+		spillfile->size = 0;
+		spillfile->failed = FALSE;
+		spills.push_back(spillfile);
+	}
+}
+
+void LASwriteBehind::remove_spill_files()
+{
+	for (size_t s = 0; s < spills.size(); s++)
+	{
+		if (spills[s]->file)
+		{
+			fclose(spills[s]->file);
+			remove(spills[s]->file_name.c_str());
+		}
+		delete spills[s];
+	}
+	spills.clear();
+}
+
+U32 LASwriteBehind::close_container()
+{
+	U32 nfailed = flush();
+	if (!container) return nfailed;
+	std::lock_guard<std::mutex> lock(container_mutex);
+	container = FALSE;
+	if (container_writer)
+	{
+		container_writer->update_header(header, TRUE);
+		container_writer->close();
+		delete container_writer;
+		container_writer = 0;
+	}
+	if (container_rawwriter)
+	{
+		if (!container_rawwriter->close())
+		{
+			fprintf(stderr, "ERROR: could not finalize '%s'\n", container_file_name.c_str());
+			nfailed++;
+		}
+		delete container_rawwriter;
+		container_rawwriter = 0;
+	}
+	FILE* file = fopen(table_file_name.c_str(), "w");
+	if (file == 0)
+	{
+		fprintf(stderr, "ERROR: could not open table '%s'\n", table_file_name.c_str());
+		return nfailed + 1;
+	}
+	std::sort(table.begin(), table.end());
+	fprintf(file, "id,name,first_point,number_of_points\n");
+	for (size_t e = 0; e < table.size(); e++)
+	{
+#ifdef _WIN32
+		fprintf(file, "%u,%s,%I64d,%I64d\n", table[e].id, table[e].name.c_str(), table[e].first, table[e].count);
+#else
+		fprintf(file, "%u,%s,%lld,%lld\n", table[e].id, table[e].name.c_str(), table[e].first, table[e].count);
+#endif
+	}
+	fclose(file);
+	if (table.size() && table.back().id > U16_MAX)
+	{
+		fprintf(stderr, "WARNING: more than %u outputs, their point_source_ID wraps around, use table '%s'\n", (U32)U16_MAX + 1, table_file_name.c_str());
+	}
+	table.clear();
+	return nfailed;
+}
+
+LASwriteBehindOutput* LASwriteBehind::open(const CHAR* file_name, const U32 id, const BOOL deferred)
+{
+	LASwriteBehindOutput* output = new LASwriteBehindOutput;
+	output->file_name = file_name;
+	//a ".las" name would make LASwriteOpener write LAS whatever the format
+	size_t dot = output->file_name.find_last_of('.');
+	size_t slash = output->file_name.find_last_of("\\/");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+	{
+		output->file_name.replace(dot + 1, std::string::npos, format);
+	}
+	output->id = id;
+	//the container is written in the order the outputs are closed
+	output->thread = (threads.size() && !container ? (U32)(next_thread++ % threads.size()) : 0);
+	output->laswriter = 0;
+	output->rawwriter = 0;
+	output->failed = FALSE;
+	output->deferred = (deferred || exact || container);
+	return output;
+}
+
+void LASwriteBehind::write_records(LASwriteBehindOutput* output, const U8* records, const size_t nrecords)
+{
+	size_t nbytes = nrecords * record_size;
+	if (output->deferred && spills.empty())
+	{
+		output->buffer.insert(output->buffer.end(), records, records + nbytes);
+		return;
+	}
+	while (nbytes)
+	{
+		size_t room = (output->buffer.size() < buffer_size ? buffer_size - output->buffer.size() : 0);
+		//whole records only
+		size_t n = (nbytes < room ? nbytes : room) / record_size * record_size;
+		if (n == 0) n = record_size;
+		output->buffer.insert(output->buffer.end(), records, records + n);
+		records += n;
+		nbytes -= n;
+		if (output->buffer.size() >= buffer_size) submit(output, FALSE);
+	}
+}
+
+void LASwriteBehind::hand_over(LASwriteBehindOutput* output)
+{
+	if (output->buffer.empty() || (output->deferred && spills.empty())) return;
+	submit(output, FALSE);
+}
+
+void LASwriteBehind::close(LASwriteBehindOutput* output)
+{
+	submit(output, TRUE);
+}
+
+void LASwriteBehind::submit(LASwriteBehindOutput* output, const BOOL last)
+{
+	LASwriteJob job;
+	job.output = output;
+	job.records = new vector<U8>;
+	job.records->swap(output->buffer);
+	job.last = last;
+	if (threads.empty())
+	{
+		//written by the calling thread, which may not be the only one
+		LASwriteOpener laswriteopener;
+		laswriteopener.set_format(format.c_str());
+		laswriteopener.set_io_obuffer_size((I32)buffer_size);
+		LASpoint point;
+		point.init(header, header->point_data_format, header->point_data_record_length);
+		process(job, &laswriteopener, &point);
+		return;
+	}
+	I64 nbytes = (I64)job.records->size();
+	{
+		//a single job larger than the cap still goes through on its own
+		std::unique_lock<std::mutex> lock(inflight_mutex);
+		while (inflight > 0 && inflight + nbytes > max_inflight) inflight_changed.wait(lock);
+		inflight += nbytes;
+		pending++;
+	}
+	LASioThread* thread = threads[output->thread];
+	{
+		std::lock_guard<std::mutex> lock(thread->mutex);
+		thread->jobs.push_back(job);
+	}
+	thread->ready.notify_one();
+}
+
+U32 LASwriteBehind::flush()
+{
+	std::unique_lock<std::mutex> lock(inflight_mutex);
+	while (pending > 0) inflight_changed.wait(lock);
+	return failed;
+}
+
+void LASwriteBehind::run(const U32 t)
+{
+	LASioThread* thread = threads[t];
+	LASwriteOpener threadwriteopener;
+	threadwriteopener.set_format(format.c_str());
+	threadwriteopener.set_io_obuffer_size((I32)buffer_size);
+	LASpoint threadpoint;
+	threadpoint.init(header, header->point_data_format, header->point_data_record_length);
+	while (true)
+	{
+		LASwriteJob job;
+		{
+			std::unique_lock<std::mutex> lock(thread->mutex);
+			while (thread->jobs.empty() && !thread->stopping) thread->ready.wait(lock);
+			if (thread->jobs.empty()) break;
+			job = thread->jobs.front();
+			thread->jobs.pop_front();
+		}
+		I64 nbytes = (I64)job.records->size();
+		process(job, &threadwriteopener, &threadpoint);
+		{
+			std::lock_guard<std::mutex> lock(inflight_mutex);
+			inflight -= nbytes;
+			pending--;
+		}
+		inflight_changed.notify_all();
+	}
+}
+
+BOOL LASwriteBehind::spill(LASwriteBehindOutput* output, const vector<U8>& records)
+{
+	if (records.empty()) return TRUE;
+	//with no I/O threads, several callers may share the spill file
+	LASspillFile* spillfile = spills[output->thread];
+	std::lock_guard<std::mutex> lock(spillfile->mutex);
+	if (spillfile->file == 0)
+	{
+		if (spillfile->failed) return FALSE;
+		spillfile->file = fopen(spillfile->file_name.c_str(), "w+b");
+		if (spillfile->file == 0)
+		{
+			fprintf(stderr, "ERROR: could not open spill file '%s'\n", spillfile->file_name.c_str());
+			spillfile->failed = TRUE;
+			return FALSE;
+		}
+	}
+	if (fseek64(spillfile->file, spillfile->size) != 0 || fwrite(&records[0], 1, records.size(), spillfile->file) != records.size()) return FALSE;
+	//buffers spilled one after the other make one run
+	if (output->spilled.size() && output->spilled.back().first + output->spilled.back().second == spillfile->size)
+	{
+		output->spilled.back().second += (I64)records.size();
+	}
+	else
+	{
+		output->spilled.push_back(std::make_pair(spillfile->size, (I64)records.size()));
+	}
+	spillfile->size += (I64)records.size();
+	return TRUE;
+}
+
+BOOL LASwriteBehind::unspill(LASwriteBehindOutput* output, const std::function<BOOL(U8*, size_t)>& write)
+{
+	if (output->spilled.empty()) return TRUE;
+	LASspillFile* spillfile = spills[output->thread];
+	vector<U8> chunk((buffer_size / record_size + 1) * record_size);
+	for (size_t s = 0; s < output->spilled.size(); s++)
+	{
+		I64 offset = output->spilled[s].first;
+		I64 left = output->spilled[s].second;
+		while (left > 0)
+		{
+			size_t n = (left < (I64)chunk.size() ? (size_t)left : chunk.size());
+			{
+				std::lock_guard<std::mutex> lock(spillfile->mutex);
+				if (spillfile->file == 0 || fseek64(spillfile->file, offset) != 0 || fread(&chunk[0], 1, n, spillfile->file) != n) return FALSE;
+			}
+			if (!write(&chunk[0], n / record_size)) return FALSE;
+			offset += (I64)n;
+			left -= (I64)n;
+		}
+	}
+	output->spilled.clear();
+	return TRUE;
+}
+
+BOOL LASwriteBehind::write_points(LASwriteBehindOutput* output, const U8* records, const size_t nrecords, LASpoint* point)
+{
+	if (output->rawwriter) return output->rawwriter->write_records(records, nrecords);
+	if (output->laswriter == 0) return FALSE;
+	for (size_t k = 0; k < nrecords; k++)
+	{
+		point->copy_from(records + k * record_size);
+		output->laswriter->write_point(point);
+		output->laswriter->update_inventory(point);
+	}
+	return TRUE;
+}
+
+void LASwriteBehind::process(const LASwriteJob& job, LASwriteOpener* laswriteopener, LASpoint* point)
+{
+	LASwriteBehindOutput* output = job.output;
+	vector<U8>& records = *job.records;
+	size_t nrecords = records.size() / record_size;
+	if (exact && output->rawwriter == 0)
+	{
+		//counts the records of the exact size file, until it is created
+		output->rawwriter = new LASrawWriter;
+		output->rawwriter->reset(header);
+	}
+	if (exact) output->rawwriter->count(nrecords ? &records[0] : 0, nrecords);
+	if (output->deferred && !job.last)
+	{
+		if (!output->failed && !spill(output, records))
+		{
+			fprintf(stderr, "ERROR: could not spill the points of '%s'\n", output->file_name.c_str());
+			output->failed = TRUE;
+			failed++;
+		}
+		delete job.records;
+		return;
+	}
+	if (container)
+	{
+		//with no I/O threads, several callers may get here at once
+		std::lock_guard<std::mutex> lock(container_mutex);
+		if (container_writer == 0 && container_rawwriter == 0 && !container_failed)
+		{
+			if (raw)
+			{
+				container_rawwriter = new LASrawWriter;
+				if (!container_rawwriter->open(laswriteopener, container_file_name.c_str(), header))
+				{
+					delete container_rawwriter;
+					container_rawwriter = 0;
+				}
+			}
+			else
+			{
+				laswriteopener->set_file_name(container_file_name.c_str());
+				container_writer = laswriteopener->open(header);
+				laswriteopener->set_file_name(0);
+			}
+			if (container_writer == 0 && container_rawwriter == 0)
+			{
+				fprintf(stderr, "ERROR: could not open laswriter for '%s'\n", container_file_name.c_str());
+				container_failed = TRUE;
+			}
+		}
+		LAScontainerEntry entry;
+		entry.id = output->id;
+		size_t slash = output->file_name.find_last_of("\\/");
+		entry.name = (slash == std::string::npos ? output->file_name : output->file_name.substr(slash + 1));
+		entry.first = (container_rawwriter ? container_rawwriter->get_number_of_points() : (container_writer ? container_writer->p_count : 0));
+		//the run of the output is its spilled records, then its last ones
+		U16 point_source_ID = (U16)output->id;
+		auto writerun = [&](U8* run, size_t nrun) -> BOOL
+		{
+			size_t r;
+			if (container_rawwriter)
+			{
+				//the point source ID follows X, Y, Z, the intensity and 4 bytes
+				for (r = 0; r < nrun; r++) memcpy(run + r * record_size + 18, &point_source_ID, 2);
+				return container_rawwriter->write_records(run, nrun);
+			}
+			if (container_writer == 0) return FALSE;
+			for (r = 0; r < nrun; r++)
+			{
+				point->copy_from(run + r * record_size);
+				point->set_point_source_ID(point_source_ID);
+				container_writer->write_point(point);
+				container_writer->update_inventory(point);
+			}
+			return TRUE;
+		};
+		BOOL ok = !output->failed && unspill(output, writerun);
+		ok = ok && writerun(nrecords ? &records[0] : 0, nrecords);
+		if (!ok && !output->failed) failed++;
+		entry.count = (container_rawwriter ? container_rawwriter->get_number_of_points() : (container_writer ? container_writer->p_count : 0)) - entry.first;
+		table.push_back(entry);
+		delete job.records;
+		delete output;
+		return;
+	}
+	if (exact)
+	{
+		//all records counted, the file is written once from the header on
+		LASrawWriter* rawwriter = output->rawwriter;
+		BOOL ok = !output->failed && rawwriter->create(output->file_name.c_str(), header_template);
+		ok = ok && unspill(output, [rawwriter](U8* spilled, size_t nspilled) { return rawwriter->append(spilled, nspilled); });
+		ok = ok && rawwriter->append(nrecords ? &records[0] : 0, nrecords);
+		if (!rawwriter->close()) ok = FALSE;
+		if (!ok && !output->failed)
+		{
+			fprintf(stderr, "ERROR: could not write '%s'\n", output->file_name.c_str());
+			failed++;
+		}
+		delete rawwriter;
+		delete job.records;
+		delete output;
+		return;
+	}
+	if (output->laswriter == 0 && output->rawwriter == 0 && !output->failed)
+	{
+		if (raw)
+		{
+			output->rawwriter = new LASrawWriter;
+			if (!output->rawwriter->open(laswriteopener, output->file_name.c_str(), header))
+			{
+				delete output->rawwriter;
+				output->rawwriter = 0;
+			}
+		}
+		else
+		{
+			laswriteopener->set_file_name(output->file_name.c_str());
+			output->laswriter = laswriteopener->open(header);
+			laswriteopener->set_file_name(0);
+		}
+		if (output->laswriter == 0 && output->rawwriter == 0)
+		{
+			fprintf(stderr, "ERROR: could not open laswriter for '%s'\n", output->file_name.c_str());
+			output->failed = TRUE;
+			failed++;
+		}
+	}
+	//a deferred output gets its spilled records first
+	BOOL ok = !output->failed;
+	ok = ok && unspill(output, [this, output, point](U8* spilled, size_t nspilled) { return write_points(output, spilled, nspilled, point); });
+	ok = ok && write_points(output, nrecords ? &records[0] : 0, nrecords, point);
+	if (!ok && !output->failed)
+	{
+		fprintf(stderr, "ERROR: could not write to '%s'\n", output->file_name.c_str());
+		output->failed = TRUE;
+		failed++;
+	}
+	delete job.records;
+	if (job.last)
+	{
+		if (output->rawwriter)
+		{
+			if (!output->rawwriter->close() && !output->failed)
+			{
+				fprintf(stderr, "ERROR: could not finalize '%s'\n", output->file_name.c_str());
+				failed++;
+			}
+			delete output->rawwriter;
+		}
+		else if (output->laswriter)
+		{
+			output->laswriter->update_header(header, TRUE);
+			output->laswriter->close();
+			delete output->laswriter;
+		}
+		delete output;
+	}
+}
@@ -0,0 +1,239 @@
+/*
+===============================================================================
+
+FILE:  laswritebehind.h
+
+CONTENTS:
+
+This file is part of LASapps collection of applications for
+LIDAR data LAS files processing and visualizing.
+
+Write-behind of LAS outputs. The clipping threads append raw point records
+to the buffer of an output and hand the buffer over once full or once the
+output is closed. A pool of I/O threads then creates, fills and finalizes
+the files in the background, so that clipping does not wait on file
+creation, on update_header() seeking back, nor on close(), nor on LAZ
+compression, each I/O thread compressing its own outputs. All buffers of
+an output go to the same I/O thread, in the order they were handed over.
+Uncompressed outputs of point formats 0 to 5 skip the point encoding, their
+records are written as they are by a LASrawWriter. In exact size mode, such
+an output is written once closed, in one sequential pass with its final
+header, instead of being patched after its points.
+
+An output whose file cannot be written before it is closed is deferred. Its
+full buffers are appended to the spill file of its I/O thread, in the
+scratch directory, and read back once it is closed, so that memory holds no
+more than a buffer per output whatever its number of points. In exact size
+mode they are counted on the way.
+
+In container mode, the outputs are deferred and appended one after the other,
+as they are closed, to a single LAS file, their points tagged with the number of the output in
+point_source_ID, and a table gives the first point and the number of points
+of each output, so that one output is read back with a single seek.
+
+THANKS:
+
+Thanks to Benoit St-Onge for ideas, concepts and supervision.
+
+PROGRAMMER:
+
+stephane.poirier@oifii.org  -  http://www.oifii.org
+
+SUPPORT:
+
+new releases - http://www.lasapps.org
+user support - https://groups.google.com/forum/#!forum/geo_spi-users
+
+COPYRIGHT:
+
+(c) 2017, Stephane Poirier
+
+This is free software; you can redistribute and/or modify it under the
+terms of the GNU Lesser General Licence as published by the Free Software
+Foundation. See the LICENSE.txt file for more information.
+
+This software is distributed WITHOUT ANY WARRANTY and without even the
+implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+CHANGE HISTORY:
+
+17 October 2026 -- container outputs deferred, their runs appended from the spill file once closed
+17 October 2026 -- deferred outputs on request, get_buffered_size() and hand_over()
+17 October 2026 -- deferred outputs spill their full buffers to the scratch directory
+17 October 2026 -- get_buffer_size() for the writer of the single pass pipeline
+17 October 2026 -- exact size mode, outputs written once with their final header
+17 October 2026 -- raw records of LAS outputs written as they are by LASrawWriter
+17 October 2026 -- file extensions follow the format, for LAZ outputs
+17 October 2026 -- container mode, all outputs in one file along with a table
+17 October 2026 -- created for lasclip per polygon outputs
+
+===============================================================================
+*/
+
+#ifndef LAS_WRITE_BEHIND_H
+#define LAS_WRITE_BEHIND_H
+
+#include "laswriter.hpp"
+#include "lasrawwriter.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+using namespace std;
+
+//output handed to the I/O threads, from LASwriteBehind::open() until it is
+//written after LASwriteBehind::close()
+class LASwriteBehindOutput
+{
+	friend class LASwriteBehind;
+protected:
+	std::string file_name;
+	U32 id;
+	U32 thread;
+	vector<U8> buffer;
+	//only touched by the I/O thread of the output
+	LASwriter* laswriter;
+	LASrawWriter* rawwriter;
+	BOOL failed;
+	//written once closed, the records handed over before wait in the spill
+	//file of the I/O thread, at these offsets and sizes
+	BOOL deferred;
+	vector< std::pair<I64, I64> > spilled;
+};
+
+class LASwriteBehind
+{
+public:
+	//outputs are written in format ("las" for example) with the header, by
+	//nthreads I/O threads or by the calling thread when nthreads is 0. the
+	//buffers of the outputs are handed over every buffer_size bytes, which
+	//is also the size of the file buffers, and the caller is made to wait as
+	//long as more than max_inflight bytes are handed over but not written.
+	BOOL setup(const LASheader* header, const CHAR* format, const U32 nthreads, const U32 buffer_size, const I64 max_inflight);
+	//switches to container mode after setup(), the outputs then all go to the
+	//container file and the table is written by close_container() as CSV
+	BOOL set_container(const CHAR* file_name, const CHAR* table_file_name);
+	inline BOOL is_container() const { return container; };
+	//switches to exact size mode after setup(), for LAS outputs of point
+	//formats 0 to 5 only. the header template is made through a scratch file.
+	BOOL set_exact_size(const CHAR* scratch_file_name);
+	inline BOOL is_exact_size() const { return exact; };
+	//the spill files of deferred outputs go to the scratch directory, set
+	//after setup(). without it, deferred outputs wait in memory until closed.
+	void set_scratch_directory(const CHAR* scratch_directory);
+	//closes and removes the spill files, once all outputs are written
+	void remove_spill_files();
+
+	//the file is only created later on, by an I/O thread. one thread at a time
+	//writes to an output, but several threads may write to different outputs.
+	//id numbers the output in the container and its table. the extension of
+	//file_name is replaced by the format, test.las becomes test.laz for laz.
+	//a deferred output holds no open file until it is closed.
+	LASwriteBehindOutput* open(const CHAR* file_name, const U32 id = 0, const BOOL deferred = FALSE);
+	//appends the raw record of a point, as laid out by LASpoint::copy_to().
+	//in container and exact size modes, outputs are deferred, so that their
+	//points are contiguous in the container or written in one pass.
+	inline void write_record(LASwriteBehindOutput* output, const U8* record)
+	{
+		output->buffer.insert(output->buffer.end(), record, record + record_size);
+		if (output->buffer.size() >= buffer_size && (!output->deferred || spills.size())) submit(output, FALSE);
+	};
+	void write_records(LASwriteBehindOutput* output, const U8* records, const size_t nrecords);
+	//bytes appended to the output but not handed over yet
+	inline size_t get_buffered_size(const LASwriteBehindOutput* output) const { return output->buffer.size(); };
+	//hands the buffer of the output over before it is full, unless the
+	//output is deferred and has no spill file
+	void hand_over(LASwriteBehindOutput* output);
+	//hands the rest of the output over, output is deleted once written
+	void close(LASwriteBehindOutput* output);
+	//waits until all outputs closed so far are written, returns the number of
+	//outputs that could not be written since the setup
+	U32 flush();
+	//flushes, then finalizes the container and writes its table. returns the
+	//number of outputs that could not be written, as flush() does.
+	U32 close_container();
+
+	inline U32 get_record_size() const { return record_size; };
+	inline size_t get_buffer_size() const { return buffer_size; };
+
+	LASwriteBehind();
+	~LASwriteBehind();
+
+protected:
+	struct LASwriteJob
+	{
+		LASwriteBehindOutput* output;
+		vector<U8>* records;
+		BOOL last;
+	};
+	struct LAScontainerEntry
+	{
+		U32 id;
+		std::string name;
+		I64 first;
+		I64 count;
+		bool operator<(const LAScontainerEntry& other) const { return id < other.id; };
+	};
+	struct LASioThread
+	{
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable ready;
+		std::deque<LASwriteJob> jobs;
+		BOOL stopping;
+	};
+	struct LASspillFile
+	{
+		std::mutex mutex;
+		std::string file_name;
+		FILE* file;
+		I64 size;
+		BOOL failed;
+	};
+	void submit(LASwriteBehindOutput* output, const BOOL last);
+	void run(const U32 t);
+	void process(const LASwriteJob& job, LASwriteOpener* laswriteopener, LASpoint* point);
+	void stop();
+	BOOL spill(LASwriteBehindOutput* output, const vector<U8>& records);
+	//hands the spilled records of output back to write, a buffer at a time
+	BOOL unspill(LASwriteBehindOutput* output, const std::function<BOOL(U8*, size_t)>& write);
+	//writes records to the file of output, as they are or point by point
+	BOOL write_points(LASwriteBehindOutput* output, const U8* records, const size_t nrecords, LASpoint* point);
+
+	const LASheader* header;
+	std::string format;
+	U32 record_size;
+	//LAS outputs whose records are written as they are
+	BOOL raw;
+	//outputs written at once, from the header and VLRs of header_template
+	BOOL exact;
+	vector<U8> header_template;
+	//one spill file per I/O thread, or one for the calling threads
+	std::string scratch_directory;
+	vector<LASspillFile*> spills;
+	size_t buffer_size;
+	I64 max_inflight;
+	vector<LASioThread*> threads;
+	std::atomic<U32> next_thread;
+	std::atomic<U32> failed;
+	//bytes handed over but not written yet, and the jobs holding them
+	std::mutex inflight_mutex;
+	std::condition_variable inflight_changed;
+	I64 inflight;
+	U32 pending;
+	//container mode, written by one thread at a time
+	BOOL container;
+	std::string container_file_name;
+	std::string table_file_name;
+	std::mutex container_mutex;
+	LASwriter* container_writer;
+	LASrawWriter* container_rawwriter;
+	BOOL container_failed;
+	vector<LAScontainerEntry> table;
+};
+
+#endif